@@ -0,0 +1,109 @@
+#include <array>
+#include <variant>
+
+#include "wbrcu/rcu_protected.hpp"
+#include "benchmark/benchmark.h"
+
+// Each update writes a block of values, which makes lambda captures too large
+// for folly::Function's inline storage.
+template <size_t N>
+struct Table {
+    struct WriteBlock {
+        size_t index;
+        std::array<uint64_t, N> values;
+    };
+    struct Increment {
+        size_t index;
+    };
+    using command = std::variant<WriteBlock, Increment>;
+
+    std::array<uint64_t, 1024> data{};
+
+    void apply(WriteBlock const& cmd) {
+        for (size_t i = 0; i < N; ++i) {
+            data[(cmd.index + i) & 1023] = cmd.values[i];
+        }
+    }
+
+    void apply(Increment const& cmd) {
+        ++data[cmd.index & 1023];
+    }
+};
+
+template <size_t N>
+class BMLambdaFixture : public benchmark::Fixture {
+public:
+    wbrcu::rcu_protected<Table<N>> p{new Table<N>{}};
+};
+
+template <size_t N>
+class BMCommandFixture : public benchmark::Fixture {
+public:
+    wbrcu::command_protected<Table<N>> p{new Table<N>{}};
+};
+
+constexpr static int write_iterations = 100;
+
+template <size_t N>
+void bm_lambda(benchmark::State& state, auto& p) {
+    uint64_t write_ops = 0;
+    typename Table<N>::WriteBlock block{};
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            block.index = rand();
+            p.update([block](Table<N>* table) { table->apply(block); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+template <size_t N>
+void bm_command(benchmark::State& state, auto& p) {
+    uint64_t write_ops = 0;
+    typename Table<N>::WriteBlock block{};
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            block.index = rand();
+            p.update(block);
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+// 2
+BENCHMARK_TEMPLATE_DEFINE_F(BMLambdaFixture, Lambda_Capture2, 2)(benchmark::State& state) {
+    bm_lambda<2>(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCommandFixture, Command_Capture2, 2)(benchmark::State& state) {
+    bm_command<2>(state, p);
+}
+
+BENCHMARK_REGISTER_F(BMLambdaFixture, Lambda_Capture2)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCommandFixture, Command_Capture2)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 16
+BENCHMARK_TEMPLATE_DEFINE_F(BMLambdaFixture, Lambda_Capture16, 16)(benchmark::State& state) {
+    bm_lambda<16>(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCommandFixture, Command_Capture16, 16)(benchmark::State& state) {
+    bm_command<16>(state, p);
+}
+
+BENCHMARK_REGISTER_F(BMLambdaFixture, Lambda_Capture16)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCommandFixture, Command_Capture16)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 64
+BENCHMARK_TEMPLATE_DEFINE_F(BMLambdaFixture, Lambda_Capture64, 64)(benchmark::State& state) {
+    bm_lambda<64>(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCommandFixture, Command_Capture64, 64)(benchmark::State& state) {
+    bm_command<64>(state, p);
+}
+
+BENCHMARK_REGISTER_F(BMLambdaFixture, Lambda_Capture64)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCommandFixture, Command_Capture64)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
@@ -0,0 +1,129 @@
+#include <thread>
+#include <vector>
+#include <random>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "wbrcu/rcu_map.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "benchmark/benchmark.h"
+
+using Map = std::unordered_map<uint64_t, uint64_t>;
+
+template <class Protected>
+class MapFixture : public benchmark::Fixture {
+public:
+    Protected p;
+
+    // Refill the map with state.range(0) keys before every run.
+    void SetUp(benchmark::State const& state) override {
+        if (state.thread_index() == 0) {
+            uint64_t num_keys = state.range(0);
+            p.update([num_keys](auto* map) {
+                map->clear();
+                for (uint64_t i = 0; i < num_keys; ++i) {
+                    map->insert_or_assign(i, i);
+                }
+            });
+        }
+    }
+};
+
+template <class ProtectedType>
+struct WBRCUMap : wbrcu::rcu_protected<ProtectedType> {
+    WBRCUMap() : wbrcu::rcu_protected<ProtectedType>{new ProtectedType{}} {}
+};
+
+template <class ProtectedType>
+struct SharedMutexMap : rwlock_protected<ProtectedType> {
+    SharedMutexMap() : rwlock_protected<ProtectedType>{new ProtectedType{}} {}
+};
+
+constexpr static int read_iterations = 100000;
+constexpr static int write_iterations = 100;
+
+bool contains(Map const& map, uint64_t key) {
+    return map.find(key) != map.end();
+}
+
+bool contains(wbrcu::rcu_map<uint64_t, uint64_t>::map_type const& map, uint64_t key) {
+    return map.find(key) != nullptr;
+}
+
+// Readers look up random keys while one background writer keeps updating.
+void bm_find(benchmark::State& state, auto& p) {
+    uint64_t num_keys = state.range(0);
+    std::jthread writer;
+    if (state.thread_index() == 0) {
+        writer = std::jthread([&](std::stop_token st) {
+            std::mt19937_64 rng{42};
+            while (!st.stop_requested()) {
+                uint64_t key = rng() % num_keys;
+                p.update([key](auto* map) { map->insert_or_assign(key, key + 1); });
+            }
+        });
+    }
+
+    std::mt19937_64 rng(state.thread_index());
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < read_iterations; ++i) {
+            auto ptr = p.get_ptr();
+            benchmark::DoNotOptimize(contains(*ptr, rng() % num_keys));
+        }
+        read_ops += read_iterations;
+    }
+
+    if (state.thread_index() == 0) {
+        writer.request_stop();
+        writer.join();
+    }
+    state.counters["read_ops_per_thread"] = benchmark::Counter(read_ops, benchmark::Counter::kIsRate);
+}
+
+// Writers assign random keys, without concurrent readers.
+void bm_insert(benchmark::State& state, auto& p) {
+    uint64_t num_keys = state.range(0);
+    std::mt19937_64 rng(state.thread_index());
+    uint64_t write_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            uint64_t key = rng() % num_keys;
+            p.update([key](auto* map) { map->insert_or_assign(key, key + 1); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, RcuMap_Find, wbrcu::rcu_map<uint64_t, uint64_t>)(benchmark::State& state) {
+    bm_find(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, WBRCU_UnorderedMap_Find, WBRCUMap<Map>)(benchmark::State& state) {
+    bm_find(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, SharedMutex_UnorderedMap_Find, SharedMutexMap<Map>)(benchmark::State& state) {
+    bm_find(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, RcuMap_Insert, wbrcu::rcu_map<uint64_t, uint64_t>)(benchmark::State& state) {
+    bm_insert(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, WBRCU_UnorderedMap_Insert, WBRCUMap<Map>)(benchmark::State& state) {
+    bm_insert(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(MapFixture, SharedMutex_UnorderedMap_Insert, SharedMutexMap<Map>)(benchmark::State& state) {
+    bm_insert(state, p);
+}
+
+BENCHMARK_REGISTER_F(MapFixture, RcuMap_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(MapFixture, WBRCU_UnorderedMap_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(MapFixture, SharedMutex_UnorderedMap_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+BENCHMARK_REGISTER_F(MapFixture, RcuMap_Insert)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(MapFixture, WBRCU_UnorderedMap_Insert)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(MapFixture, SharedMutex_UnorderedMap_Insert)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
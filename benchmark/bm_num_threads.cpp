@@ -4,6 +4,7 @@
 
 #include "common.hpp"
 #include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/seqlock_protected.hpp"
 #include "benchmark/benchmark.h"
 
 template <class ProtectedType>
@@ -12,6 +13,12 @@ public:
     wbrcu::rcu_protected<ProtectedType> p{new ProtectedType{}};
 };
 
+template <class ProtectedType>
+class SeqlockFixture : public benchmark::Fixture {
+public:
+    wbrcu::seqlock_protected<ProtectedType> p{new ProtectedType{}};
+};
+
 template <class ProtectedType>
 class FollyRCUFixture : public benchmark::Fixture {
 public:
@@ -47,6 +54,19 @@ BENCHMARK_TEMPLATE_DEFINE_F(WBRCUFixture, WBRCU_ProtectInt_Reader, uint64_t)(ben
     state.counters["total_read_ops"] = benchmark::Counter(read_ops * state.threads(), benchmark::Counter::kIsRate);;
 }
 
+BENCHMARK_TEMPLATE_DEFINE_F(SeqlockFixture, Seqlock_ProtectInt_Reader, uint64_t)(benchmark::State& state) {
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        int k;
+        for (int i = 0; i < read_iterations; ++i) {
+            auto ptr = p.get_ptr();
+            benchmark::DoNotOptimize(k = *ptr);
+        }
+        read_ops += read_iterations;
+    }
+    state.counters["total_read_ops"] = benchmark::Counter(read_ops * state.threads(), benchmark::Counter::kIsRate);;
+}
+
 BENCHMARK_TEMPLATE_DEFINE_F(FollyRCUFixture, FollyRCU_ProtectInt_Reader, uint64_t)(benchmark::State& state) {
     uint64_t read_ops = 0;
     for (auto _ : state) {
@@ -97,6 +117,17 @@ BENCHMARK_TEMPLATE_DEFINE_F(WBRCUFixture, WBRCU_ProtectInt_Writer, uint64_t)(ben
     state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);;
 }
 
+BENCHMARK_TEMPLATE_DEFINE_F(SeqlockFixture, Seqlock_ProtectInt_Writer, uint64_t)(benchmark::State& state) {
+    uint64_t write_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            p.update([](uint64_t* ptr) { ++(*ptr); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);;
+}
+
 BENCHMARK_TEMPLATE_DEFINE_F(FollyRCUFixture, FollyRCU_ProtectInt_Writer, uint64_t)(benchmark::State& state) {
     uint64_t write_ops = 0;
     for (auto _ : state) {
@@ -132,11 +163,13 @@ BENCHMARK_TEMPLATE_DEFINE_F(MutexFixture, Mutex_ProtectInt_Writer, uint64_t)(ben
 
 
 BENCHMARK_REGISTER_F(WBRCUFixture, WBRCU_ProtectInt_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(SeqlockFixture, Seqlock_ProtectInt_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(FollyRCUFixture, FollyRCU_ProtectInt_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(SharedMutexFixture, SharedMutex_ProtectInt_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(MutexFixture, Mutex_ProtectInt_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 
 BENCHMARK_REGISTER_F(WBRCUFixture, WBRCU_ProtectInt_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(SeqlockFixture, Seqlock_ProtectInt_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(FollyRCUFixture, FollyRCU_ProtectInt_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(SharedMutexFixture, SharedMutex_ProtectInt_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(MutexFixture, Mutex_ProtectInt_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
@@ -0,0 +1,114 @@
+#include <thread>
+#include <vector>
+#include <random>
+#include <map>
+
+#include "common.hpp"
+#include "wbrcu/rcu_ordered_map.hpp"
+#include "benchmark/benchmark.h"
+
+using Map = std::map<uint64_t, uint64_t>;
+using RcuOrderedMap = wbrcu::rcu_ordered_map<uint64_t, uint64_t>;
+
+template <class Protected>
+class OrderedMapFixture : public benchmark::Fixture {
+public:
+    Protected p;
+
+    // Refill the map with state.range(0) keys before every run.
+    void SetUp(benchmark::State const& state) override {
+        if (state.thread_index() == 0) {
+            uint64_t num_keys = state.range(0);
+            p.update([num_keys](auto* map) {
+                map->clear();
+                for (uint64_t i = 0; i < num_keys; ++i) {
+                    map->insert_or_assign(i, i);
+                }
+            });
+        }
+    }
+};
+
+template <class ProtectedType>
+struct SharedMutexMap : rwlock_protected<ProtectedType> {
+    SharedMutexMap() : rwlock_protected<ProtectedType>{new ProtectedType{}} {}
+};
+
+constexpr static int read_iterations = 10000;
+constexpr static int scan_length = 64;
+
+uint64_t lookup(Map const& map, uint64_t key) {
+    auto it = map.find(key);
+    return it != map.end() ? it->second : 0;
+}
+
+uint64_t lookup(RcuOrderedMap::map_type const& map, uint64_t key) {
+    auto const* value = map.find(key);
+    return value ? *value : 0;
+}
+
+// Sums up to scan_length values starting from lower_bound(key).
+uint64_t scan(auto const& map, uint64_t key) {
+    uint64_t sum = 0;
+    int n = 0;
+    for (auto it = map.lower_bound(key); it != map.end() && n < scan_length; ++it, ++n) {
+        sum += it->second;
+    }
+    return sum;
+}
+
+// Readers run op on random keys while one background writer keeps updating.
+void bm_read(benchmark::State& state, auto& p, auto op) {
+    uint64_t num_keys = state.range(0);
+    std::jthread writer;
+    if (state.thread_index() == 0) {
+        writer = std::jthread([&](std::stop_token st) {
+            std::mt19937_64 rng{42};
+            while (!st.stop_requested()) {
+                uint64_t key = rng() % num_keys;
+                p.update([key](auto* map) { map->insert_or_assign(key, key + 1); });
+            }
+        });
+    }
+
+    std::mt19937_64 rng(state.thread_index());
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < read_iterations; ++i) {
+            auto ptr = p.get_ptr();
+            benchmark::DoNotOptimize(op(*ptr, rng() % num_keys));
+        }
+        read_ops += read_iterations;
+    }
+
+    if (state.thread_index() == 0) {
+        writer.request_stop();
+        writer.join();
+    }
+    state.counters["read_ops_per_thread"] = benchmark::Counter(read_ops, benchmark::Counter::kIsRate);
+}
+
+constexpr static auto find_op = [](auto const& map, uint64_t key) { return lookup(map, key); };
+constexpr static auto scan_op = [](auto const& map, uint64_t key) { return scan(map, key); };
+
+BENCHMARK_TEMPLATE_DEFINE_F(OrderedMapFixture, RcuOrderedMap_Find, RcuOrderedMap)(benchmark::State& state) {
+    bm_read(state, p, find_op);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(OrderedMapFixture, SharedMutex_Map_Find, SharedMutexMap<Map>)(benchmark::State& state) {
+    bm_read(state, p, find_op);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(OrderedMapFixture, RcuOrderedMap_RangeScan, RcuOrderedMap)(benchmark::State& state) {
+    bm_read(state, p, scan_op);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(OrderedMapFixture, SharedMutex_Map_RangeScan, SharedMutexMap<Map>)(benchmark::State& state) {
+    bm_read(state, p, scan_op);
+}
+
+BENCHMARK_REGISTER_F(OrderedMapFixture, RcuOrderedMap_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(OrderedMapFixture, SharedMutex_Map_Find)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+BENCHMARK_REGISTER_F(OrderedMapFixture, RcuOrderedMap_RangeScan)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(OrderedMapFixture, SharedMutex_Map_RangeScan)->RangeMultiplier(16)->Range(1 << 10, 1 << 18)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
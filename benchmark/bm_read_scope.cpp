@@ -0,0 +1,102 @@
+#include <array>
+#include <memory>
+#include <utility>
+
+#include "wbrcu/read_scope.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "benchmark/benchmark.h"
+
+// A request reads N protected objects.
+template <size_t N>
+class ChainedFixture : public benchmark::Fixture {
+public:
+    std::array<std::unique_ptr<wbrcu::rcu_protected<uint64_t>>, N> objs;
+
+    ChainedFixture() {
+        for (size_t i = 0; i < N; ++i) {
+            objs[i] = std::make_unique<wbrcu::rcu_protected<uint64_t>>(new uint64_t(i));
+        }
+    }
+};
+
+template <size_t N>
+class ScopeFixture : public benchmark::Fixture {
+public:
+    wbrcu::rcu_domain<> domain;
+    std::array<std::unique_ptr<wbrcu::rcu_protected<uint64_t>>, N> objs;
+
+    ScopeFixture() {
+        for (size_t i = 0; i < N; ++i) {
+            objs[i] = std::make_unique<wbrcu::rcu_protected<uint64_t>>(new uint64_t(i), domain);
+        }
+    }
+};
+
+constexpr static int read_iterations = 100000;
+
+void bm_chained(benchmark::State& state, auto& objs) {
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < read_iterations; ++i) {
+            uint64_t sum = 0;
+            for (auto& obj : objs) {
+                sum += *obj->get_ptr();
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        read_ops += read_iterations;
+    }
+    state.counters["requests_per_thread"] = benchmark::Counter(read_ops, benchmark::Counter::kIsRate);
+}
+
+void bm_scope(benchmark::State& state, auto& domain, auto& objs) {
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < read_iterations; ++i) {
+            uint64_t sum = 0;
+            wbrcu::read_scope scope{domain};
+            for (auto& obj : objs) {
+                sum += *scope.get(*obj);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        read_ops += read_iterations;
+    }
+    state.counters["requests_per_thread"] = benchmark::Counter(read_ops, benchmark::Counter::kIsRate);
+}
+
+// 2
+BENCHMARK_TEMPLATE_DEFINE_F(ChainedFixture, GetPtr_Objects2, 2)(benchmark::State& state) {
+    bm_chained(state, objs);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ScopeFixture, ReadScope_Objects2, 2)(benchmark::State& state) {
+    bm_scope(state, domain, objs);
+}
+
+BENCHMARK_REGISTER_F(ChainedFixture, GetPtr_Objects2)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ScopeFixture, ReadScope_Objects2)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 5
+BENCHMARK_TEMPLATE_DEFINE_F(ChainedFixture, GetPtr_Objects5, 5)(benchmark::State& state) {
+    bm_chained(state, objs);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ScopeFixture, ReadScope_Objects5, 5)(benchmark::State& state) {
+    bm_scope(state, domain, objs);
+}
+
+BENCHMARK_REGISTER_F(ChainedFixture, GetPtr_Objects5)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ScopeFixture, ReadScope_Objects5)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 10
+BENCHMARK_TEMPLATE_DEFINE_F(ChainedFixture, GetPtr_Objects10, 10)(benchmark::State& state) {
+    bm_chained(state, objs);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ScopeFixture, ReadScope_Objects10, 10)(benchmark::State& state) {
+    bm_scope(state, domain, objs);
+}
+
+BENCHMARK_REGISTER_F(ChainedFixture, GetPtr_Objects10)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ScopeFixture, ReadScope_Objects10)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
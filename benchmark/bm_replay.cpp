@@ -0,0 +1,136 @@
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/trace.hpp"
+#include "benchmark/benchmark.h"
+
+// Replays a trace of reads and updates against each protected type, keeping
+// the recorded timing and threads: every trace thread gets a thread that
+// starts each operation at its recorded offset, and holds read pointers for
+// the recorded critical-section length.
+//
+// Set WBRCU_REPLAY_TRACE to a trace written by trace_recorder::write from a
+// live object built with the WBRCU_TRACING option. Without it, a synthetic
+// trace of WBRCU_HARDWARE_CONCURRENCY threads is generated.
+//
+// Updates replay as a small write, their recorded duration is the latency
+// their caller saw and is not simulated. lag_ns is how late operations
+// started on average, which grows when a protected type cannot keep up with
+// the trace.
+
+struct Data {
+    std::array<uint64_t, 8> values{};
+};
+
+void simulate_work(uint64_t nanoseconds) {
+    auto start = std::chrono::steady_clock::now();
+    while (std::chrono::steady_clock::now() - start < std::chrono::nanoseconds(nanoseconds)) {
+    }
+}
+
+std::vector<wbrcu::trace_event> synthetic_trace() {
+    constexpr int events_per_thread = 5000;
+    std::mt19937_64 rng(42);
+    std::exponential_distribution<double> gap(1.0 / 2000);
+    std::uniform_int_distribution<uint32_t> read_length(50, 1000);
+    std::bernoulli_distribution is_update(0.01);
+
+    std::vector<wbrcu::trace_event> events;
+    for (uint16_t t = 0; t < WBRCU_HARDWARE_CONCURRENCY; ++t) {
+        uint64_t start = 0;
+        for (int i = 0; i < events_per_thread; ++i) {
+            bool update = is_update(rng);
+            uint32_t duration = update ? 0 : read_length(rng);
+            events.push_back({start, duration, t,
+                update ? wbrcu::trace_kind::update : wbrcu::trace_kind::read});
+            start += duration + static_cast<uint64_t>(gap(rng));
+        }
+    }
+    return events;
+}
+
+// Events of each trace thread, in order.
+std::vector<std::vector<wbrcu::trace_event>> const& trace() {
+    static auto threads = [] {
+        char const* path = std::getenv("WBRCU_REPLAY_TRACE");
+        auto events = path ? wbrcu::read_trace(path) : synthetic_trace();
+        std::vector<std::vector<wbrcu::trace_event>> threads;
+        for (auto const& event : events) {
+            if (event.thread >= threads.size()) {
+                threads.resize(event.thread + 1);
+            }
+            threads[event.thread].push_back(event);
+        }
+        return threads;
+    }();
+    return threads;
+}
+
+constexpr auto spin_window = std::chrono::microseconds(50);
+
+template <class ProtectedType>
+void BM_Replay(benchmark::State& state) {
+    auto const& threads = trace();
+    uint64_t ops = 0;
+    uint64_t lag = 0;
+    for (auto _ : state) {
+        ProtectedType p{new Data{}};
+        std::atomic<bool> go(false);
+        std::atomic<uint64_t> total_lag(0);
+        std::chrono::steady_clock::time_point start;
+
+        std::vector<std::thread> workers;
+        for (auto const& events : threads) {
+            workers.emplace_back([&]() {
+                while (!go.load(std::memory_order_acquire)) {
+                    std::this_thread::yield();
+                }
+                uint64_t thread_lag = 0;
+                for (auto const& event : events) {
+                    auto due = start + std::chrono::nanoseconds(event.start_ns);
+                    auto now = std::chrono::steady_clock::now();
+                    if (now < due) {
+                        // Sleep through long gaps, spin through the last
+                        // stretch to start on time.
+                        if (due - now > spin_window) {
+                            std::this_thread::sleep_until(due - spin_window);
+                        }
+                        while (std::chrono::steady_clock::now() < due) {
+                        }
+                    } else {
+                        thread_lag += std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count();
+                    }
+                    if (event.kind == wbrcu::trace_kind::read) {
+                        auto ptr = p.get_ptr();
+                        benchmark::DoNotOptimize(ptr->values[0]);
+                        simulate_work(event.duration_ns);
+                    } else {
+                        p.update([](Data* d) { ++d->values[0]; });
+                    }
+                }
+                total_lag.fetch_add(thread_lag);
+            });
+            ops += events.size();
+        }
+        start = std::chrono::steady_clock::now() + std::chrono::milliseconds(1);
+        go.store(true, std::memory_order_release);
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        lag += total_lag.load();
+    }
+    state.counters["ops"] = benchmark::Counter(ops, benchmark::Counter::kIsRate);
+    state.counters["lag_ns"] = benchmark::Counter(static_cast<double>(lag) / ops);
+}
+
+BENCHMARK_TEMPLATE(BM_Replay, wbrcu::rcu_protected<Data>)->Name("WBRCU_Replay")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, follyrcu_protected<Data>)->Name("FollyRCU_Replay")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, rwlock_protected<Data>)->Name("SharedMutex_Replay")->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Replay, lock_protected<Data>)->Name("Mutex_Replay")->UseRealTime()->Unit(benchmark::kMillisecond);
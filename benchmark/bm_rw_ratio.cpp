@@ -4,6 +4,7 @@
 
 #include "common.hpp"
 #include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/seqlock_protected.hpp"
 #include "benchmark/benchmark.h"
 
 template <template<typename> class Protect>
@@ -91,6 +92,10 @@ BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, WBRCU_Reader, wbrcu::rcu_protected)(be
     bm_read(state, p);
 }
 
+BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, Seqlock_Reader, wbrcu::seqlock_protected)(benchmark::State& state) {
+    bm_read(state, p);
+}
+
 BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, FollyRCU_Reader, follyrcu_protected)(benchmark::State& state) {
     bm_read(state, p);
 }
@@ -107,6 +112,10 @@ BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, WBRCU_Writer, wbrcu::rcu_protected)(be
     bm_write(state, p);
 }
 
+BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, Seqlock_Writer, wbrcu::seqlock_protected)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
 BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, FollyRCU_Writer, follyrcu_protected)(benchmark::State& state) {
     bm_write(state, p);
 }
@@ -120,11 +129,13 @@ BENCHMARK_TEMPLATE_DEFINE_F(RatioFixture, Mutex_Writer, lock_protected)(benchmar
 }
 
 BENCHMARK_REGISTER_F(RatioFixture, WBRCU_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
+BENCHMARK_REGISTER_F(RatioFixture, Seqlock_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, FollyRCU_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, SharedMutex_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, Mutex_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 
 BENCHMARK_REGISTER_F(RatioFixture, WBRCU_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
+BENCHMARK_REGISTER_F(RatioFixture, Seqlock_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, FollyRCU_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, SharedMutex_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
 BENCHMARK_REGISTER_F(RatioFixture, Mutex_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY-1);
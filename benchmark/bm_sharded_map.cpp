@@ -0,0 +1,117 @@
+#include <thread>
+#include <vector>
+#include <random>
+#include <unordered_map>
+
+#include "common.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/sharded_map.hpp"
+#include "benchmark/benchmark.h"
+
+using Map = std::unordered_map<uint64_t, uint64_t>;
+
+constexpr static uint64_t num_keys = 1 << 12;
+
+class WBRCUFixture : public benchmark::Fixture {
+public:
+    wbrcu::rcu_protected<Map> p{new Map{}};
+};
+
+template <std::size_t Shards>
+class ShardedFixture : public benchmark::Fixture {
+public:
+    wbrcu::sharded_map<uint64_t, uint64_t, Shards> p;
+};
+
+class SharedMutexFixture : public benchmark::Fixture {
+public:
+    rwlock_protected<Map> p{new Map{}};
+};
+
+constexpr static int read_iterations = 100000;
+constexpr static int write_iterations = 100;
+
+void insert(auto& p, uint64_t key) {
+    p.update([key](Map* map) { (*map)[key] = key; });
+}
+
+template <std::size_t Shards>
+void insert(wbrcu::sharded_map<uint64_t, uint64_t, Shards>& p, uint64_t key) {
+    p.insert_or_assign(key, key);
+}
+
+bool contains(auto& p, uint64_t key) {
+    auto ptr = p.get_ptr();
+    return ptr->contains(key);
+}
+
+template <std::size_t Shards>
+bool contains(wbrcu::sharded_map<uint64_t, uint64_t, Shards>& p, uint64_t key) {
+    return p.contains(key);
+}
+
+void bm_write(benchmark::State& state, auto& p) {
+    std::mt19937_64 rng(state.thread_index());
+    uint64_t write_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            insert(p, rng() % num_keys);
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+void bm_read(benchmark::State& state, auto& p) {
+    std::mt19937_64 rng(state.thread_index());
+    uint64_t read_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < read_iterations; ++i) {
+            benchmark::DoNotOptimize(contains(p, rng() % num_keys));
+        }
+        read_ops += read_iterations;
+    }
+    state.counters["total_read_ops"] = benchmark::Counter(read_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_DEFINE_F(WBRCUFixture, WBRCU_Writer)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ShardedFixture, Sharded4_Writer, 4)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ShardedFixture, Sharded16_Writer, 16)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ShardedFixture, Sharded64_Writer, 64)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
+BENCHMARK_DEFINE_F(SharedMutexFixture, SharedMutex_Writer)(benchmark::State& state) {
+    bm_write(state, p);
+}
+
+BENCHMARK_DEFINE_F(WBRCUFixture, WBRCU_Reader)(benchmark::State& state) {
+    bm_read(state, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(ShardedFixture, Sharded16_Reader, 16)(benchmark::State& state) {
+    bm_read(state, p);
+}
+
+BENCHMARK_DEFINE_F(SharedMutexFixture, SharedMutex_Reader)(benchmark::State& state) {
+    bm_read(state, p);
+}
+
+BENCHMARK_REGISTER_F(WBRCUFixture, WBRCU_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ShardedFixture, Sharded4_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ShardedFixture, Sharded16_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ShardedFixture, Sharded64_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(SharedMutexFixture, SharedMutex_Writer)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+BENCHMARK_REGISTER_F(WBRCUFixture, WBRCU_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(ShardedFixture, Sharded16_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(SharedMutexFixture, SharedMutex_Reader)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
@@ -1,6 +1,9 @@
 #include <thread>
 #include <array>
 #include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
 
 #include "common.hpp"
 #include "wbrcu/rcu_protected.hpp"
@@ -12,6 +15,33 @@ struct ArrayData {
     std::array<uint64_t, N> data{};
 };
 
+// Same layout as ArrayData, but always copied through the cache.
+template <size_t N>
+struct TemporalArrayData : ArrayData<N> {};
+
+template <size_t N>
+struct wbrcu::use_streaming_copy<TemporalArrayData<N>> : std::false_type {};
+
+// String-heavy data, every string is too long for the small string buffer.
+constexpr static size_t num_strings = 64;
+constexpr static size_t string_length = 48;
+
+struct StringData {
+    std::vector<std::string> strings{num_strings, std::string(string_length, 'x')};
+};
+
+// Same data with pmr members, so that each version can allocate them from
+// its arena with arena_cloner.
+struct PmrStringData {
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+    std::pmr::vector<std::pmr::string> strings;
+
+    explicit PmrStringData(allocator_type alloc = {})
+        : strings(num_strings, std::pmr::string(string_length, 'x'), alloc) {}
+    PmrStringData(PmrStringData const& other, allocator_type alloc)
+        : strings(other.strings, alloc) {}
+};
+
 template <template<typename> class Protect, size_t N>
 class BMSizeOfDataFixture : public benchmark::Fixture {
 public:
@@ -19,6 +49,26 @@ public:
     Protect<ArrayData<N>> p{new ArrayData<N>{}};
 };
 
+template <size_t N>
+class BMTemporalCopyFixture : public benchmark::Fixture {
+public:
+    size_t sz = N;
+    wbrcu::rcu_protected<TemporalArrayData<N>> p{new TemporalArrayData<N>{}};
+};
+
+class BMStringDataFixture : public benchmark::Fixture {
+public:
+    wbrcu::default_cloner<StringData> cloner;
+    wbrcu::rcu_protected<StringData> p{new StringData{}};
+};
+
+class BMArenaStringDataFixture : public benchmark::Fixture {
+public:
+    using cloner_type = wbrcu::arena_cloner<PmrStringData>;
+    cloner_type cloner{16 * 1024};
+    wbrcu::rcu_protected<PmrStringData, 0, 20, cloner_type> p{cloner.create(), cloner};
+};
+
 constexpr static int write_iterations = 100;
 
 void bm_func(benchmark::State& state, size_t sz, auto& p) {
@@ -34,6 +84,31 @@ void bm_func(benchmark::State& state, size_t sz, auto& p) {
     state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);;
 }
 
+void bm_strings_func(benchmark::State& state, auto& p) {
+    uint64_t write_ops = 0;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            size_t index = rand() % num_strings;
+            p.update([index](auto* ptr) { ++ptr->strings[index].back(); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+// Cost of a version the object pool cannot provide, e.g. while it is empty:
+// copying it from scratch and destroying it.
+void bm_clone_func(benchmark::State& state, auto const& cloner, auto const& src) {
+    uint64_t copies = 0;
+    for (auto _ : state) {
+        auto* copy = cloner.clone(src);
+        benchmark::DoNotOptimize(copy);
+        cloner.destroy(copy);
+        ++copies;
+    }
+    state.counters["copies"] = benchmark::Counter(copies * state.threads(), benchmark::Counter::kIsRate);
+}
+
 // 2
 BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, WBRCU_Size2, wbrcu::rcu_protected, 2)(benchmark::State& state) {
     bm_func(state, sz, p);
@@ -207,4 +282,66 @@ BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, Mutex_Size65536, lock_protected
 BENCHMARK_REGISTER_F(BMSizeOfDataFixture, WBRCU_Size65536)->Threads(WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(BMSizeOfDataFixture, FollyRCU_Size65536)->Threads(WBRCU_HARDWARE_CONCURRENCY);
 BENCHMARK_REGISTER_F(BMSizeOfDataFixture, SharedMutex_Size65536)->Threads(WBRCU_HARDWARE_CONCURRENCY);
-BENCHMARK_REGISTER_F(BMSizeOfDataFixture, Mutex_Size65536)->Threads(WBRCU_HARDWARE_CONCURRENCY);
\ No newline at end of file
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, Mutex_Size65536)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+
+// 131072 (1MiB), large enough for WBRCU to copy with non-temporal stores.
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, WBRCU_Size131072, wbrcu::rcu_protected, 131072)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMTemporalCopyFixture, WBRCU_Temporal_Size131072, 131072)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, FollyRCU_Size131072, follyrcu_protected, 131072)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, SharedMutex_Size131072, rwlock_protected, 131072)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, Mutex_Size131072, lock_protected, 131072)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, WBRCU_Size131072)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMTemporalCopyFixture, WBRCU_Temporal_Size131072)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, FollyRCU_Size131072)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, SharedMutex_Size131072)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, Mutex_Size131072)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+
+// 524288 (4MiB), large enough for WBRCU to copy with non-temporal stores.
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, WBRCU_Size524288, wbrcu::rcu_protected, 524288)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMTemporalCopyFixture, WBRCU_Temporal_Size524288, 524288)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, FollyRCU_Size524288, follyrcu_protected, 524288)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, SharedMutex_Size524288, rwlock_protected, 524288)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_TEMPLATE_DEFINE_F(BMSizeOfDataFixture, Mutex_Size524288, lock_protected, 524288)(benchmark::State& state) {
+    bm_func(state, sz, p);
+}
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, WBRCU_Size524288)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMTemporalCopyFixture, WBRCU_Temporal_Size524288)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, FollyRCU_Size524288)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, SharedMutex_Size524288)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMSizeOfDataFixture, Mutex_Size524288)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+
+// Strings, copied through the heap or through the per-version arena.
+BENCHMARK_DEFINE_F(BMStringDataFixture, WBRCU_Strings)(benchmark::State& state) {
+    bm_strings_func(state, p);
+}
+BENCHMARK_DEFINE_F(BMArenaStringDataFixture, WBRCU_Arena_Strings)(benchmark::State& state) {
+    bm_strings_func(state, p);
+}
+BENCHMARK_DEFINE_F(BMStringDataFixture, WBRCU_StringsClone)(benchmark::State& state) {
+    bm_clone_func(state, cloner, *p.get_ptr());
+}
+BENCHMARK_DEFINE_F(BMArenaStringDataFixture, WBRCU_Arena_StringsClone)(benchmark::State& state) {
+    bm_clone_func(state, cloner, *p.get_ptr());
+}
+BENCHMARK_REGISTER_F(BMStringDataFixture, WBRCU_Strings)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMArenaStringDataFixture, WBRCU_Arena_Strings)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMStringDataFixture, WBRCU_StringsClone)->Threads(WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMArenaStringDataFixture, WBRCU_Arena_StringsClone)->Threads(WBRCU_HARDWARE_CONCURRENCY);
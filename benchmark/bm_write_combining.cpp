@@ -0,0 +1,93 @@
+#include <array>
+
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/write_combiner.hpp"
+#include "benchmark/benchmark.h"
+
+// Counter workload: every write increments one counter.
+template <size_t N>
+struct Counters {
+    std::array<uint64_t, N> data{};
+};
+
+template <size_t N>
+struct AddCounters {
+    void operator()(Counters<N>* counters, Counters<N>&& delta) const {
+        for (size_t i = 0; i < N; ++i) {
+            counters->data[i] += delta.data[i];
+        }
+    }
+};
+
+template <size_t N>
+class BMCountersFixture : public benchmark::Fixture {
+public:
+    using Protected = wbrcu::rcu_protected<Counters<N>>;
+    size_t sz = N;
+    Protected p{new Counters<N>{}};
+    wbrcu::write_combiner<Protected, Counters<N>, AddCounters<N>> combiner{p};
+};
+
+constexpr static int write_iterations = 100;
+
+void bm_queue(benchmark::State& state, size_t sz, auto& p) {
+    uint64_t write_ops = 0;
+    auto const mask = sz - 1;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            size_t index = rand() & mask;
+            p.update([index](auto* ptr) { ++(ptr->data[index]); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+void bm_combine(benchmark::State& state, size_t sz, auto& combiner) {
+    uint64_t write_ops = 0;
+    auto const mask = sz - 1;
+    for (auto _ : state) {
+        for (int i = 0; i < write_iterations; ++i) {
+            size_t index = rand() & mask;
+            combiner.combine([index](auto& delta) { ++(delta.data[index]); });
+        }
+        write_ops += write_iterations;
+    }
+    state.counters["total_write_ops"] = benchmark::Counter(write_ops * state.threads(), benchmark::Counter::kIsRate);
+}
+
+// 8
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Queue_Size8, 8)(benchmark::State& state) {
+    bm_queue(state, sz, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Combine_Size8, 8)(benchmark::State& state) {
+    bm_combine(state, sz, combiner);
+}
+
+BENCHMARK_REGISTER_F(BMCountersFixture, Queue_Size8)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCountersFixture, Combine_Size8)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 64
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Queue_Size64, 64)(benchmark::State& state) {
+    bm_queue(state, sz, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Combine_Size64, 64)(benchmark::State& state) {
+    bm_combine(state, sz, combiner);
+}
+
+BENCHMARK_REGISTER_F(BMCountersFixture, Queue_Size64)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCountersFixture, Combine_Size64)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+
+// 1024
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Queue_Size1024, 1024)(benchmark::State& state) {
+    bm_queue(state, sz, p);
+}
+
+BENCHMARK_TEMPLATE_DEFINE_F(BMCountersFixture, Combine_Size1024, 1024)(benchmark::State& state) {
+    bm_combine(state, sz, combiner);
+}
+
+BENCHMARK_REGISTER_F(BMCountersFixture, Queue_Size1024)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
+BENCHMARK_REGISTER_F(BMCountersFixture, Combine_Size1024)->ThreadRange(1, WBRCU_HARDWARE_CONCURRENCY);
@@ -0,0 +1,243 @@
+#pragma once
+
+#include "detail/StreamingCopy.hpp"
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wbrcu
+{
+
+// A Cloner tells rcu_protected how the updater makes its private copy of T.
+//   clone(src)           allocates a new copy of src, used when the object
+//                        pool is empty.
+//   clone_into(dst, src) turns a reclaimed object from the object pool into a
+//                        copy of src.
+//   destroy(ptr)         optional, frees an object returned by clone. Defaults
+//                        to delete.
+// Types that can share unchanged parts between versions, e.g. persistent data
+// structures, can make clone copy only what an update is going to modify.
+template <typename C, typename T>
+concept cloner_for = requires(C& cloner, T& dst, T const& src) {
+    { cloner.clone(src) } -> std::same_as<T*>;
+    cloner.clone_into(dst, src);
+};
+
+// Copies T with its copy constructor, and reuses pooled objects with copy
+// assignment if T has it, or by destroying and copy constructing in place if
+// not.
+template <typename T>
+struct default_cloner
+{
+    T*
+    clone(T const& src) const
+    {
+        return detail::copy_new(src);
+    }
+
+    void
+    clone_into(T& dst, T const& src) const
+    {
+        if constexpr (std::is_copy_assignable_v<T>)
+        {
+            detail::copy_assign(dst, src);
+        }
+        else
+        {
+            std::destroy_at(std::addressof(dst));
+            std::construct_at(std::addressof(dst), src);
+        }
+    }
+
+    void
+    destroy(T* ptr) const noexcept
+    {
+        delete ptr;
+    }
+};
+
+// Gives every version of T its own monotonic arena that T's members allocate
+// from. T must be allocator-aware with std::pmr::polymorphic_allocator, e.g. a
+// struct of std::pmr containers declaring allocator_type and an
+// allocator-extended copy constructor.
+//
+// A version lives in a single block holding the arena, T and the arena's
+// initial buffer of arenaSize bytes. Copying a version allocates from the
+// buffer instead of the heap, and destroying one frees the block at once.
+// A pooled version is reused with copy assignment while its arena fits in the
+// buffer, which keeps the capacity of its members like default_cloner does.
+// Once members have outgrown the buffer and spilled to the heap, the version
+// is destroyed, its arena reset in O(1) and the copy made afresh.
+//
+// The initial object must be made by create, since destroy expects a block.
+template <typename T>
+    requires std::uses_allocator_v<T, std::pmr::polymorphic_allocator<>>
+class arena_cloner
+{
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    explicit arena_cloner(std::size_t arenaSize = 4096) noexcept
+        : m_arenaSize{arenaSize}
+    {}
+
+    // Makes a version from args, constructed with the allocator of its arena.
+    template <typename... Args>
+    T*
+    create(Args&&... args) const
+    {
+        auto* header = allocate();
+        try
+        {
+            return std::uninitialized_construct_using_allocator(
+                value_of(header),
+                allocator_type{&header->arena},
+                std::forward<Args>(args)...
+            );
+        }
+        catch (...)
+        {
+            deallocate(header);
+            throw;
+        }
+    }
+
+    T*
+    clone(T const& src) const
+    {
+        return create(src);
+    }
+
+    void
+    clone_into(T& dst, T const& src) const
+    {
+        auto* header = header_of(&dst);
+        if constexpr (std::is_copy_assignable_v<T>)
+        {
+            // Assignment keeps dst's allocator, it allocates from the arena.
+            if (!header->upstream.spilled)
+            {
+                dst = src;
+                return;
+            }
+        }
+        std::destroy_at(std::addressof(dst));
+        header->arena.release();
+        header->upstream.spilled = false;
+        std::uninitialized_construct_using_allocator(
+            std::addressof(dst), allocator_type{&header->arena}, src
+        );
+    }
+
+    void
+    destroy(T* ptr) const noexcept
+    {
+        std::destroy_at(ptr);
+        deallocate(header_of(ptr));
+    }
+
+private:
+    // Heap memory of an arena whose buffer is exhausted.
+    struct Upstream : std::pmr::memory_resource
+    {
+        bool spilled = false;
+
+        void*
+        do_allocate(std::size_t bytes, std::size_t alignment) override
+        {
+            spilled = true;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void
+        do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool
+        do_is_equal(std::pmr::memory_resource const& other
+        ) const noexcept override
+        {
+            return this == &other;
+        }
+    };
+
+    struct Header
+    {
+        Header(std::byte* buffer, std::size_t bufferSize, std::size_t blockSize)
+            : arena{buffer, bufferSize, &upstream}, blockSize{blockSize}
+        {}
+
+        Upstream                            upstream;
+        std::pmr::monotonic_buffer_resource arena;
+        std::size_t                         blockSize;
+    };
+
+    constexpr static std::size_t blockAlign = std::max(
+        {alignof(Header), alignof(T), alignof(std::max_align_t)}
+    );
+    constexpr static std::size_t valueOffset =
+        (sizeof(Header) + alignof(T) - 1) / alignof(T) * alignof(T);
+    constexpr static std::size_t bufferOffset =
+        (valueOffset + sizeof(T) + alignof(std::max_align_t) - 1)
+        / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+    std::size_t m_arenaSize;
+
+    Header*
+    allocate() const
+    {
+        std::size_t blockSize = bufferOffset + m_arenaSize;
+        auto*       block     = static_cast<std::byte*>(
+            ::operator new(blockSize, std::align_val_t{blockAlign})
+        );
+        return ::new (block) Header{block + bufferOffset, m_arenaSize, blockSize};
+    }
+
+    static void
+    deallocate(Header* header) noexcept
+    {
+        std::size_t blockSize = header->blockSize;
+        std::destroy_at(header);
+        ::operator delete(
+            static_cast<void*>(header), blockSize, std::align_val_t{blockAlign}
+        );
+    }
+
+    static T*
+    value_of(Header* header) noexcept
+    {
+        return reinterpret_cast<T*>(
+            reinterpret_cast<std::byte*>(header) + valueOffset
+        );
+    }
+
+    static Header*
+    header_of(T* ptr) noexcept
+    {
+        return std::launder(reinterpret_cast<Header*>(
+            reinterpret_cast<std::byte*>(ptr) - valueOffset
+        ));
+    }
+};
+
+namespace detail
+{
+
+template <typename T, typename Cloner>
+void
+destroy_with(Cloner& cloner, T* ptr) noexcept
+{
+    if constexpr (requires { cloner.destroy(ptr); }) { cloner.destroy(ptr); }
+    else { delete ptr; }
+}
+
+} // namespace detail
+
+} // namespace wbrcu
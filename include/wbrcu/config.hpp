@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace wbrcu
+{
+
+inline constexpr uint64_t hardware_concurrency = WBRCU_HARDWARE_CONCURRENCY;
+
+} // namespace wbrcu
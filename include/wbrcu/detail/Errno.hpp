@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <system_error>
+
+namespace wbrcu::detail
+{
+
+// Reports the failed system call what with the current errno.
+[[noreturn]] inline void
+throw_errno(char const* what)
+{
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+// Like throw_errno, for failures the caller cannot recover from: reports
+// them on stderr and aborts.
+[[noreturn]] inline void
+abort_errno(char const* what) noexcept
+{
+    std::fprintf(stderr, "wbrcu: %s: %s\n", what, std::strerror(errno));
+    std::abort();
+}
+
+} // namespace wbrcu::detail
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <climits>
+#include <ctime>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace wbrcu::detail
+{
+
+// Minimal wrappers of the Linux futex syscall on a 32-bit atomic word. Other
+// platforms fall back to sleeping in short steps.
+//
+// futex_wait blocks while word holds expected, until futex_wake_all is called
+// on word or timeout elapses. It may return spuriously, callers re-check their
+// condition.
+
+#if defined(__linux__)
+
+inline void
+futex_wait(
+    std::atomic<uint32_t>& word, uint32_t expected, timespec const* timeout
+) noexcept
+{
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t));
+    syscall(
+        SYS_futex,
+        reinterpret_cast<uint32_t*>(&word),
+        FUTEX_WAIT_PRIVATE,
+        expected,
+        timeout,
+        nullptr,
+        0
+    );
+}
+
+inline void
+futex_wait(std::atomic<uint32_t>& word, uint32_t expected) noexcept
+{
+    futex_wait(word, expected, nullptr);
+}
+
+inline void
+futex_wait(
+    std::atomic<uint32_t>& word,
+    uint32_t               expected,
+    std::chrono::nanoseconds timeout
+) noexcept
+{
+    auto     secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    timespec ts{};
+    ts.tv_sec  = static_cast<time_t>(secs.count());
+    ts.tv_nsec = static_cast<long>((timeout - secs).count());
+    futex_wait(word, expected, &ts);
+}
+
+inline void
+futex_wake_all(std::atomic<uint32_t>& word) noexcept
+{
+    syscall(
+        SYS_futex,
+        reinterpret_cast<uint32_t*>(&word),
+        FUTEX_WAKE_PRIVATE,
+        INT_MAX,
+        nullptr,
+        nullptr,
+        0
+    );
+}
+
+#else
+
+inline void
+futex_wait(
+    std::atomic<uint32_t>& word,
+    uint32_t               expected,
+    std::chrono::nanoseconds timeout
+) noexcept
+{
+    if (word.load(std::memory_order_acquire) == expected)
+    {
+        std::this_thread::sleep_for(
+            std::min<std::chrono::nanoseconds>(timeout, std::chrono::milliseconds{1})
+        );
+    }
+}
+
+inline void
+futex_wait(std::atomic<uint32_t>& word, uint32_t expected) noexcept
+{
+    futex_wait(word, expected, std::chrono::milliseconds{1});
+}
+
+inline void
+futex_wake_all(std::atomic<uint32_t>&) noexcept
+{}
+
+#endif
+
+} // namespace wbrcu::detail
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace wbrcu
+{
+
+// Objects at least this large are copied with non-temporal stores when they
+// are trivially copyable, see use_streaming_copy.
+inline constexpr std::size_t streaming_copy_threshold = std::size_t{1} << 20;
+
+// Whether the updater copies T with non-temporal stores. A streamed copy
+// bypasses the cache, so copying a multi-megabyte T neither evicts the lines
+// that readers are working on nor pays for write-allocating the destination.
+// Specialize it to opt a type in or out.
+template <typename T>
+struct use_streaming_copy
+    : std::bool_constant<
+          std::is_trivially_copyable_v<T>
+          && sizeof(T) >= streaming_copy_threshold>
+{
+};
+
+namespace detail
+{
+
+#if defined(__x86_64__)
+
+// Distance in bytes that the copy loops prefetch the source ahead.
+inline constexpr std::size_t streamingPrefetchDistance = 1024;
+
+// Copy the bytes until dst is aligned to Alignment, returns the number of
+// bytes copied.
+template <std::size_t Alignment>
+inline std::size_t
+copy_unaligned_head(std::byte* dst, std::byte const* src, std::size_t n)
+{
+    auto misaligned = reinterpret_cast<std::uintptr_t>(dst) % Alignment;
+    auto head       = misaligned ? std::min(n, Alignment - misaligned) : 0;
+    std::memcpy(dst, src, head);
+    return head;
+}
+
+// Prefetch the source streamingPrefetchDistance bytes past offset done,
+// unless that is beyond the n bytes of src.
+inline void
+prefetch_ahead(std::byte const* src, std::size_t done, std::size_t n) noexcept
+{
+    if (n - done > streamingPrefetchDistance)
+    {
+        _mm_prefetch(
+            reinterpret_cast<char const*>(src + done + streamingPrefetchDistance),
+            _MM_HINT_NTA
+        );
+    }
+}
+
+__attribute__((target("avx512f"))) inline void
+streaming_copy_avx512(std::byte* dst, std::byte const* src, std::size_t n)
+{
+    auto done = copy_unaligned_head<64>(dst, src, n);
+    for (; done + 64 <= n; done += 64)
+    {
+        prefetch_ahead(src, done, n);
+        auto v = _mm512_loadu_si512(src + done);
+        _mm512_stream_si512(reinterpret_cast<__m512i*>(dst + done), v);
+    }
+    _mm_sfence();
+    std::memcpy(dst + done, src + done, n - done);
+}
+
+__attribute__((target("avx2"))) inline void
+streaming_copy_avx2(std::byte* dst, std::byte const* src, std::size_t n)
+{
+    auto done = copy_unaligned_head<32>(dst, src, n);
+    for (; done + 64 <= n; done += 64)
+    {
+        prefetch_ahead(src, done, n);
+        auto lo = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(src + done)
+        );
+        auto hi = _mm256_loadu_si256(
+            reinterpret_cast<__m256i const*>(src + done + 32)
+        );
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + done), lo);
+        _mm256_stream_si256(reinterpret_cast<__m256i*>(dst + done + 32), hi);
+    }
+    _mm_sfence();
+    std::memcpy(dst + done, src + done, n - done);
+}
+
+#endif
+
+inline void
+memcpy_copy(std::byte* dst, std::byte const* src, std::size_t n)
+{
+    std::memcpy(dst, src, n);
+}
+
+using StreamingCopyFunc = void (*)(std::byte*, std::byte const*, std::size_t);
+
+// Pick the widest copy loop that the running CPU supports.
+inline StreamingCopyFunc
+select_streaming_copy() noexcept
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) { return streaming_copy_avx512; }
+    if (__builtin_cpu_supports("avx2")) { return streaming_copy_avx2; }
+#endif
+    return memcpy_copy;
+}
+
+// Copy n bytes from src to dst with non-temporal stores when the CPU supports
+// them. The regions must not overlap.
+inline void
+streaming_copy(void* dst, void const* src, std::size_t n)
+{
+    static StreamingCopyFunc const copy = select_streaming_copy();
+    copy(static_cast<std::byte*>(dst), static_cast<std::byte const*>(src), n);
+}
+
+// Assign src to dst, streaming the bytes if use_streaming_copy<T> holds.
+template <typename T>
+void
+copy_assign(T& dst, T const& src)
+{
+    if constexpr (use_streaming_copy<T>::value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        streaming_copy(std::addressof(dst), std::addressof(src), sizeof(T));
+    }
+    else { dst = src; }
+}
+
+// Allocate a copy of src, streaming the bytes if use_streaming_copy<T> holds
+// and allocating T does not need to initialize it.
+template <typename T>
+T*
+copy_new(T const& src)
+{
+    if constexpr (use_streaming_copy<T>::value
+                  && std::is_trivially_default_constructible_v<T>)
+    {
+        T* copied = new T;
+        streaming_copy(copied, std::addressof(src), sizeof(T));
+        return copied;
+    }
+    else { return new T(src); }
+}
+
+} // namespace detail
+
+} // namespace wbrcu
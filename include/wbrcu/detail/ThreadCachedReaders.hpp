@@ -2,22 +2,53 @@
 
 #include "folly/ThreadLocal.h"
 #include "folly/synchronization/RelaxedAtomic.h"
+#include <cstdio>
+#include <cstdlib>
 
 namespace wbrcu::detail
 {
 
 using EpochReading = folly::relaxed_atomic<uint8_t>;
 
+// Maximum nesting depth of read-side critical sections in one thread.
+inline constexpr uint8_t max_read_depth = 63;
+
+// Enter a read-side critical section of epoch on the reader slot of the
+// calling thread. A nested section keeps the epoch of the outermost one,
+// which is what protects every object loaded inside it. Nesting deeper than
+// max_read_depth would wrap the depth and leave the section unprotected, so
+// it aborts, in release builds too.
+inline void
+reader_lock(EpochReading& reading, uint8_t epoch) noexcept
+{
+    uint8_t curr = reading;
+    if ((curr >> 2) == max_read_depth) [[unlikely]]
+    {
+        std::fputs("wbrcu: read-side critical sections nested too deep\n", stderr);
+        std::abort();
+    }
+    reading.store(curr ? curr + 4 : (epoch << 1) + 5);
+}
+
+// Leave the innermost read-side critical section on reading.
+inline void
+reader_unlock(EpochReading& reading) noexcept
+{
+    uint8_t curr = reading;
+    reading.store(curr < 8 ? 0 : curr - 4);
+}
+
 // A data structure that keeps a per-thread cache of a bitfield that contains
 // the current active epoch for reader in the thread, and whether the reader
 // is in the read-side critical section.
 //
 //                _______________________________________
-//                |  Irrelevant |   Epoch   |  Reading  |
+//                |    Depth    |   Epoch   |  Reading  |
 // EpochReading:  | 7 6 5 4 3 2 |     1     |     0     |
 //                o-------------|-----------|-----------o
 //
-// Note that this does not handle nested read-side critical section.
+// Depth counts the nested read-side critical sections of the thread, up to
+// max_read_depth, and only the outermost one records the epoch.
 template <class ThreadLocalTag>
 class ThreadCachedReaders
 {
@@ -25,13 +56,20 @@ public:
     void
     increment(uint8_t epoch)
     {
-        epochReading->store((epoch << 1) + 1);
+        reader_lock(*epochReading, epoch);
     }
 
     void
     decrement()
     {
-        epochReading->store(0);
+        reader_unlock(*epochReading);
+    }
+
+    // Returns the reader slot of the calling thread.
+    EpochReading&
+    local()
+    {
+        return *epochReading;
     }
 
     bool
@@ -42,7 +80,7 @@ public:
             access.begin(),
             access.end(),
             [reading = static_cast<uint8_t>((epoch << 1) + 1)](EpochReading& i)
-            { return i == reading; }
+            { return (i & 3) == reading; }
         );
     }
 
@@ -50,4 +88,4 @@ private:
     folly::ThreadLocal<EpochReading, ThreadLocalTag> epochReading;
 };
 
-} // namespace wbrcu::detail
\ No newline at end of file
+} // namespace wbrcu::detail
@@ -0,0 +1,580 @@
+#pragma once
+
+#include "../config.hpp"
+#include "Futex.hpp"
+#include "folly/Function.h"
+#include "folly/MPMCQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined(WBRCU_TRACING)
+#include "../trace.hpp"
+// Records the enclosing update call to the recorder of the object, if any.
+#define WBRCU_TRACE_UPDATE() \
+    ::wbrcu::detail::TraceScope wbrcuTraceScope { this->m_trace }
+#else
+#define WBRCU_TRACE_UPDATE()
+#endif
+
+namespace wbrcu
+{
+
+namespace detail
+{
+
+template <typename T, typename Command>
+concept applies = requires(T& t, Command const& command) { t.apply(command); };
+
+template <typename T, typename Variant>
+struct applies_all : std::false_type
+{
+};
+
+template <typename T, typename... Commands>
+struct applies_all<T, std::variant<Commands...>>
+    : std::bool_constant<(applies<T, Commands> && ...)>
+{
+};
+
+} // namespace detail
+
+// A closed set of update operations on T: a std::variant of command structs,
+// each of which T applies with t.apply(command).
+template <typename Command, typename T>
+concept command_set_for = detail::applies_all<T, Command>::value;
+
+} // namespace wbrcu
+
+namespace wbrcu::detail
+{
+
+struct TransactionAccess;
+
+// Update-side front end shared by the protected types. Every call to update
+// either registers the caller as the single updater or enqueues the update for
+// the updater to apply, so updates are serialized without a lock and applied
+// in batches.
+//
+// Derived provides the updater-side storage:
+//   T*   get_copy()         returns the private object the updater modifies.
+//   void publish(T* copied) makes the modified object visible to readers.
+// Both are only ever called by the registered updater.
+//
+// Update is the type an update is stored as in the queue. By default it is a
+// type-erased callable invoked with the copy. If it is a command_set_for T,
+// updates are commands stored by value and applied with std::visit.
+template <
+    typename Derived,
+    typename T,
+    uint64_t flushingThreshold,
+    typename Update = folly::Function<void(T*)>>
+class UpdateBatcher
+{
+    constexpr static bool isCommandSet = command_set_for<Update, T>;
+
+    friend struct TransactionAccess;
+
+public:
+    template <std::invocable<T*> UpdateFunc>
+        requires(!isCommandSet)
+    void
+    update(UpdateFunc&& updateCallback)
+    {
+        WBRCU_TRACE_UPDATE();
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            // Registered as the updater.
+            // First perform the update which current thread intends.
+            std::invoke(std::forward<UpdateFunc>(updateCallback), copied);
+
+            // Then perform the updates in m_updateQueue.
+            do_updates(copied);
+        }
+        else
+        {
+            // Other updater is working, enqueue the update to perform.
+            m_updateQueue.blockingWrite(
+                QueuedUpdate{std::forward<UpdateFunc>(updateCallback), ticket}
+            );
+        }
+    }
+
+    // Apply command, one of the alternatives of Update, to T.
+    template <typename Command>
+        requires isCommandSet && std::constructible_from<Update, Command&&>
+    void
+    update(Command&& command)
+    {
+        WBRCU_TRACE_UPDATE();
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            if constexpr (requires { copied->apply(command); })
+            {
+                copied->apply(command);
+                if (m_recordApplied.load(std::memory_order_relaxed))
+                {
+                    record(Update{std::forward<Command>(command)});
+                }
+            }
+            else
+            {
+                Update update{std::forward<Command>(command)};
+                apply(copied, update);
+                record(std::move(update));
+            }
+            do_updates(copied);
+        }
+        else
+        {
+            m_updateQueue.blockingWrite(
+                QueuedUpdate{std::forward<Command>(command), ticket}
+            );
+        }
+    }
+
+    // Like update, but within a batch only the latest update of each key is
+    // applied, the earlier ones are dropped and count as completed. Keyed
+    // updates are applied before any unkeyed update that was enqueued after
+    // them, so updateCallback should overwrite the state it is keyed on
+    // rather than depend on it.
+    template <typename UpdateFunc>
+        requires(isCommandSet || std::invocable<UpdateFunc, T*>)
+             && std::constructible_from<Update, UpdateFunc&&>
+    void
+    update_keyed(uint64_t key, UpdateFunc&& updateCallback)
+    {
+        WBRCU_TRACE_UPDATE();
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            defer(key, std::forward<UpdateFunc>(updateCallback));
+            do_updates(copied);
+        }
+        else
+        {
+            m_updateQueue.blockingWrite(
+                QueuedUpdate{std::forward<UpdateFunc>(updateCallback), ticket, key}
+            );
+        }
+    }
+
+    // Like update, but returns only once the update has been published, and
+    // so committed to the journal of Derived if it keeps one. A caller that
+    // becomes the updater publishes the batch itself, others sleep until the
+    // updater has published the batch holding their update.
+    template <typename UpdateArg>
+        requires(isCommandSet || std::invocable<UpdateArg, T*>)
+             && std::constructible_from<Update, UpdateArg&&>
+    void
+    update_sync(UpdateArg&& update)
+    {
+        WBRCU_TRACE_UPDATE();
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            Update own{std::forward<UpdateArg>(update)};
+            apply(copied, own);
+            record(std::move(own));
+            do_updates(copied);
+            return;
+        }
+
+        std::atomic<uint32_t> completed{0};
+        m_updateQueue.blockingWrite(QueuedUpdate{
+            std::forward<UpdateArg>(update), ticket, std::nullopt, &completed
+        });
+        while (!completed.load(std::memory_order_acquire))
+        {
+            futex_wait(completed, 0);
+        }
+    }
+
+#if defined(WBRCU_TRACING)
+    // Record the reads and updates of this object to recorder, which must
+    // outlive it. Must be called before the object is shared between threads.
+    void
+    trace_to(trace_recorder& recorder) noexcept
+    {
+        m_trace = &recorder;
+    }
+#endif
+
+protected:
+    struct QueuedUpdate
+    {
+        // Empty only for the marker of register_exclusive, which needs no
+        // Update, so that Update may have no default constructor.
+        std::optional<Update> update;
+        // Value of m_updateCnt the update was counted at. Tickets of one
+        // thread grow in program order, see next_update.
+        uint64_t ticket = 0;
+        // Set for updates enqueued by update_keyed.
+        std::optional<uint64_t> key = std::nullopt;
+        // Set for updates enqueued by update_sync, the word its caller sleeps
+        // on until the update is published.
+        std::atomic<uint32_t>* completion = nullptr;
+        // Set for the marker enqueued by register_exclusive instead of an
+        // update, the word its caller sleeps on until it is the updater.
+        std::atomic<uint32_t>* handoff = nullptr;
+    };
+
+    struct OverflowNode
+    {
+        QueuedUpdate  queued;
+        OverflowNode* next;
+    };
+
+    // Count of updates to do for updater, every call to update will increment
+    // it. If it is greater than 0, then there is an updater in work, the call
+    // to update will enqueue the update-to-do. This atomic variable effectively
+    // prevents data race on the updater-owned state of Derived.
+    std::atomic<uint64_t> m_updateCnt{0};
+    // Queue of updates to perform.
+    folly::MPMCQueue<QueuedUpdate> m_updateQueue{500 * hardware_concurrency};
+    // Updates enqueued by update_nonblocking while m_updateQueue was full, a
+    // lock-free stack pushed by any thread and taken whole by the updater.
+    std::atomic<OverflowNode*> m_overflow{nullptr};
+    // Overflowed updates taken by the updater and not performed yet, by
+    // ticket, and the head of the queue read ahead to be compared with them.
+    // Only accessed by the updater.
+    OverflowNode*               m_overflowTaken = nullptr;
+    std::optional<QueuedUpdate> m_readAhead;
+    // Keyed updates of the current batch that are not applied yet, at most
+    // one per key. Only accessed by the updater.
+    std::vector<std::pair<uint64_t, Update>> m_deferred;
+    // Commands applied to the copy being built, in order, recorded while
+    // m_recordApplied is set so that Derived can pass them on at publish.
+    // Only accessed by the updater, which clears it after publishing.
+    std::vector<Update> m_applied;
+    std::atomic<bool>   m_recordApplied{false};
+    // Completion words of the update_sync callers whose update was applied to
+    // the copy being built. Only accessed by the updater.
+    std::vector<std::atomic<uint32_t>*> m_completions;
+    // Copy and count of performed updates the updater handed to the caller of
+    // register_exclusive, which takes over the updater role with them.
+    T*       m_handoffCopy = nullptr;
+    uint64_t m_handoffDone = 0;
+#if defined(WBRCU_TRACING)
+    trace_recorder* m_trace = nullptr;
+#endif
+
+    // Returns a pointer to the copied object if current thread successfully
+    // register as the updater, otherwise returns nullptr and sets ticket for
+    // the update to enqueue.
+    T*
+    try_register(uint64_t& ticket)
+    {
+        // Sequentially consistent, so that the order of the tickets agrees
+        // with the order in which a thread's updates enter the queue.
+        ticket = m_updateCnt.fetch_add(1, std::memory_order_seq_cst);
+        if (!ticket) { return derived().get_copy(); }
+        return nullptr;
+    }
+
+    // Like update, but never blocks: when the queue is full, the update is
+    // pushed to an overflow stack that the updater drains as well.
+    template <typename UpdateFunc>
+    void
+    update_nonblocking(UpdateFunc&& updateCallback)
+    {
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            std::invoke(std::forward<UpdateFunc>(updateCallback), copied);
+            do_updates(copied);
+            return;
+        }
+
+        QueuedUpdate queued{std::forward<UpdateFunc>(updateCallback), ticket};
+        if (m_updateQueue.write(std::move(queued))) { return; }
+
+        auto* node = new OverflowNode{std::move(queued), nullptr};
+        node->next = m_overflow.load(std::memory_order_relaxed);
+        while (!m_overflow.compare_exchange_weak(
+            node->next, node, std::memory_order_release, std::memory_order_relaxed
+        ))
+        {
+        }
+    }
+
+    // Blocks until current thread is the updater, for callers that publish on
+    // their own instead of going through do_updates. Returns a pointer to the
+    // copied object.
+    //
+    // Rather than waiting for the update count to drop to 0, which a steady
+    // stream of updates may never let happen, the caller enqueues a marker
+    // and the updater hands its role and copy over when it reaches it.
+    T*
+    register_exclusive()
+    {
+        uint64_t ticket;
+        if (T* copied = try_register(ticket); copied)
+        {
+            m_handoffDone = 1;
+            return copied;
+        }
+        std::atomic<uint32_t> handedOver{0};
+        m_updateQueue.blockingWrite(QueuedUpdate{
+            std::nullopt, ticket, std::nullopt, nullptr, &handedOver
+        });
+        while (!handedOver.load(std::memory_order_acquire))
+        {
+            futex_wait(handedOver, 0);
+        }
+        return m_handoffCopy;
+    }
+
+    // Give up the updater role taken by register_exclusive once the copy has
+    // been published, performing the updates enqueued in the meantime.
+    void
+    finish_exclusive()
+    {
+        uint64_t expected = m_handoffDone;
+        if (m_updateCnt.compare_exchange_strong(
+                expected, 0, std::memory_order_release, std::memory_order_relaxed
+            ))
+        {
+            return;
+        }
+        do_updates(derived().get_copy(), m_handoffDone, false);
+    }
+
+    // Perform updates in the update queue, publish updates and hand the copied
+    // object over to Derived. done is the number of counted updates already
+    // performed, modified whether copied holds any of them.
+    void
+    do_updates(T* copied, uint64_t done = 1, bool modified = true)
+    {
+        QueuedUpdate updateToDo;
+        auto updateCnt = m_updateCnt.load(std::memory_order_relaxed);
+        while (true)
+        {
+            uint64_t unflushed = 0;
+            do {
+                while (done < updateCnt)
+                {
+                    next_update(updateToDo);
+                    if (updateToDo.handoff)
+                    {
+                        // Publish the updates before it, so that their
+                        // callers do not wait for the transaction.
+                        if (modified)
+                        {
+                            apply_deferred(copied);
+                            derived().publish(copied);
+                            complete_batch();
+                            copied = derived().get_copy();
+                        }
+                        hand_off(copied, done + 1, *updateToDo.handoff);
+                        return;
+                    }
+                    modified = true;
+                    if (updateToDo.completion)
+                    {
+                        m_completions.push_back(updateToDo.completion);
+                    }
+                    if (updateToDo.key)
+                    {
+                        defer(*updateToDo.key, std::move(*updateToDo.update));
+                    }
+                    else
+                    {
+                        apply_deferred(copied);
+                        apply(copied, *updateToDo.update);
+                        record(std::move(*updateToDo.update));
+                    }
+                    ++done;
+                    if (++unflushed == flushingThreshold) {
+                        break;
+                    }
+                }
+
+                if (unflushed == flushingThreshold) {
+                    break;
+                }
+                updateCnt = m_updateCnt.load(std::memory_order_relaxed);
+            } while (done != updateCnt);
+
+            // Publish updates to readers.
+            apply_deferred(copied);
+            derived().publish(copied);
+            complete_batch();
+
+            // Check if there is new updates enqueued after we publish the
+            // updates
+            if (done == updateCnt && m_updateCnt.compare_exchange_strong(
+                    updateCnt,
+                    0,
+                    std::memory_order_release,
+                    std::memory_order_relaxed
+                ))
+            {
+                return; // Finished updating
+            }
+
+            copied   = derived().get_copy();
+            modified = false;
+        }
+    }
+
+private:
+    // Take the next counted update from the queue, or from the overflow stack
+    // if it was pushed there. The update may still be in flight when its
+    // enqueuer has incremented m_updateCnt but not written it yet.
+    //
+    // A thread's update that overflowed must still be applied before its
+    // later ones that found room in the queue, so while there are overflowed
+    // updates the one with the smallest ticket is taken. The stack is checked
+    // after the queue: an update read from the queue was written after the
+    // overflowed updates of its thread were pushed.
+    void
+    next_update(QueuedUpdate& updateToDo)
+    {
+        while (true)
+        {
+            bool queued = true;
+            if (m_readAhead)
+            {
+                updateToDo = std::move(*m_readAhead);
+                m_readAhead.reset();
+            }
+            else { queued = m_updateQueue.read(updateToDo); }
+
+            take_overflow();
+            if (m_overflowTaken
+                && (!queued || m_overflowTaken->queued.ticket < updateToDo.ticket))
+            {
+                if (queued) { m_readAhead.emplace(std::move(updateToDo)); }
+                auto* node      = m_overflowTaken;
+                m_overflowTaken = node->next;
+                updateToDo      = std::move(node->queued);
+                delete node;
+                return;
+            }
+            if (queued) { return; }
+            std::this_thread::yield();
+        }
+    }
+
+    // Merge the updates pushed to the overflow stack into m_overflowTaken,
+    // keeping it sorted by ticket.
+    void
+    take_overflow()
+    {
+        if (!m_overflow.load(std::memory_order_relaxed)) { return; }
+        auto* node = m_overflow.exchange(nullptr, std::memory_order_acquire);
+        std::vector<OverflowNode*> nodes;
+        for (; node; node = node->next) { nodes.push_back(node); }
+        for (node = m_overflowTaken; node; node = node->next)
+        {
+            nodes.push_back(node);
+        }
+        std::sort(
+            nodes.begin(),
+            nodes.end(),
+            [](OverflowNode const* lhs, OverflowNode const* rhs)
+            { return lhs->queued.ticket < rhs->queued.ticket; }
+        );
+        m_overflowTaken = nullptr;
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+        {
+            (*it)->next     = m_overflowTaken;
+            m_overflowTaken = *it;
+        }
+    }
+
+    // Hand the updater role over to the caller of register_exclusive waiting
+    // on handoff, along with copied and the count of updates performed.
+    void
+    hand_off(T* copied, uint64_t done, std::atomic<uint32_t>& handoff) noexcept
+    {
+        m_handoffCopy = copied;
+        m_handoffDone = done;
+        // The caller may return as soon as it sees the store, see
+        // complete_batch.
+        handoff.store(1, std::memory_order_release);
+        futex_wake_all(handoff);
+    }
+
+    // Wake the update_sync callers of the published batch.
+    void
+    complete_batch() noexcept
+    {
+        for (auto* completion : m_completions)
+        {
+            // The caller may return as soon as it sees the store, waking an
+            // address that is no longer waited on is harmless.
+            completion->store(1, std::memory_order_release);
+            futex_wake_all(*completion);
+        }
+        m_completions.clear();
+    }
+
+    // Holds the keyed update until the batch ends or an unkeyed update comes,
+    // replacing the pending update of the same key if there is one. Batches
+    // are short, so a linear search is cheaper than hashing.
+    void
+    defer(uint64_t key, Update update)
+    {
+        for (auto& [deferredKey, deferredUpdate] : m_deferred)
+        {
+            if (deferredKey == key)
+            {
+                deferredUpdate = std::move(update);
+                return;
+            }
+        }
+        m_deferred.emplace_back(key, std::move(update));
+    }
+
+    void
+    apply_deferred(T* copied)
+    {
+        for (auto& [key, update] : m_deferred)
+        {
+            apply(copied, update);
+            record(std::move(update));
+        }
+        m_deferred.clear();
+    }
+
+    void
+    record(Update&& update)
+    {
+        if constexpr (isCommandSet)
+        {
+            if (m_recordApplied.load(std::memory_order_relaxed))
+            {
+                m_applied.push_back(std::move(update));
+            }
+        }
+    }
+
+    static void
+    apply(T* copied, Update& update)
+    {
+        if constexpr (isCommandSet)
+        {
+            std::visit([copied](auto const& command) { copied->apply(command); }, update);
+        }
+        else { update(copied); }
+    }
+
+    Derived&
+    derived() noexcept
+    {
+        return static_cast<Derived&>(*this);
+    }
+};
+
+} // namespace wbrcu::detail
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+
+namespace wbrcu::detail
+{
+
+// Window of the last published versions of an object, addressable by version
+// number. Version v is kept in slot v % window until version v + window
+// replaces it.
+//
+// Only the updater records versions. Readers look them up inside a read-side
+// critical section, validating the slot like a seqlock, so that a pointer is
+// only returned while the slot still holds the requested version. The caller
+// of record retires the replaced pointer, which keeps it alive for readers
+// that found it before.
+template <typename T>
+class VersionHistory
+{
+public:
+    explicit VersionHistory(std::size_t window)
+        : m_window{window}, m_slots{std::make_unique<Slot[]>(window)}
+    {}
+
+    // Stores ptr as version, returns the pointer of the version it replaces,
+    // or nullptr if the slot was empty.
+    T*
+    record(uint64_t version, T* ptr) noexcept
+    {
+        Slot& slot    = m_slots[version % m_window];
+        T*    evicted = slot.ptr.load(std::memory_order_relaxed);
+        slot.version.store(empty, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.ptr.store(ptr, std::memory_order_relaxed);
+        slot.version.store(version, std::memory_order_release);
+        return evicted;
+    }
+
+    // Returns the object of version if it is in the window, nullptr
+    // otherwise.
+    T*
+    find(uint64_t version) const noexcept
+    {
+        Slot const& slot = m_slots[version % m_window];
+        if (slot.version.load(std::memory_order_acquire) != version)
+        {
+            return nullptr;
+        }
+        T* ptr = slot.ptr.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) != version)
+        {
+            return nullptr;
+        }
+        return ptr;
+    }
+
+    std::size_t
+    window() const noexcept
+    {
+        return m_window;
+    }
+
+    // Visits every recorded pointer. Only called by the owner once no reader
+    // is left.
+    template <typename Visitor>
+    void
+    for_each(Visitor&& visitor) const
+    {
+        for (std::size_t i = 0; i < m_window; ++i)
+        {
+            if (T* ptr = m_slots[i].ptr.load(std::memory_order_relaxed))
+            {
+                visitor(ptr);
+            }
+        }
+    }
+
+private:
+    constexpr static uint64_t empty = std::numeric_limits<uint64_t>::max();
+
+    struct Slot
+    {
+        std::atomic<uint64_t> version{empty};
+        std::atomic<T*>       ptr{nullptr};
+    };
+
+    std::size_t             m_window;
+    std::unique_ptr<Slot[]> m_slots;
+};
+
+} // namespace wbrcu::detail
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "detail/Errno.hpp"
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <span>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+// Write-ahead journal of the commands applied to a command_protected object,
+// attached with journal_to. The updater appends the commands of every batch
+// as one frame with a single write and fdatasync before publishing the
+// batch, so a whole batch shares the cost of one sync, and nothing becomes
+// visible to readers or completes update_sync before it is durable.
+//
+// Commands are written as their bytes, so Command must be trivially copyable
+// and must not hold pointers. A frame is
+//     version, count, checksum, Command[count]
+// where version is the one the batch was published as, offset by the last
+// version of the journal when it was opened, so that versions keep growing
+// across restarts. replay stops at the first frame that is not complete.
+// Opening a journal cuts off a frame torn by a crash, so that the frames
+// appended after it are replayed.
+//
+// A failed write or sync leaves durability unknown, the updater cannot
+// recover from it and aborts the process.
+template <typename Command>
+class journal
+{
+    // Checked on use rather than as a constraint, so that rcu_protected can
+    // name journal<Update> for any Update.
+    static_assert(std::is_trivially_copyable_v<Command>);
+
+public:
+    explicit journal(std::filesystem::path const& path)
+    {
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        if (m_fd < 0) { detail::throw_errno("journal open"); }
+        try
+        {
+            auto contents = read_all(m_fd);
+            auto [last, end] = scan(contents, [](uint64_t, Command const&) {});
+            if (end != contents.size())
+            {
+                if (::ftruncate(m_fd, static_cast<off_t>(end)) != 0)
+                {
+                    detail::throw_errno("journal ftruncate");
+                }
+                if (::fsync(m_fd) != 0) { detail::throw_errno("journal fsync"); }
+            }
+            m_base = last;
+        }
+        catch (...)
+        {
+            ::close(m_fd);
+            throw;
+        }
+    }
+
+    journal(journal const&)            = delete;
+    journal& operator=(journal const&) = delete;
+
+    ~journal() { ::close(m_fd); }
+
+    // Version of the last complete frame when the journal was opened, which
+    // the versions of the frames appended since are offset by.
+    uint64_t
+    base_version() const noexcept
+    {
+        return m_base;
+    }
+
+    // Appends the commands of the batch published as version and waits until
+    // they are durable. The frame is gathered from the header and commands
+    // with writev, so committing allocates nothing and cannot throw.
+    void
+    commit(std::span<Command const> commands, uint64_t version) noexcept
+    {
+        Frame frame{m_base + version, commands.size(), checksum(commands)};
+        ::iovec parts[2]{
+            {&frame, sizeof(Frame)},
+            {const_cast<Command*>(commands.data()), commands.size_bytes()}
+        };
+
+        ::iovec* pending = parts;
+        int      count   = 2;
+        while (count > 0)
+        {
+            ssize_t written = ::writev(m_fd, pending, count);
+            if (written < 0)
+            {
+                if (errno == EINTR) { continue; }
+                detail::abort_errno("journal write");
+            }
+            // Skip what was written, resuming within a part if need be.
+            auto left = static_cast<std::size_t>(written);
+            while (count > 0 && left >= pending->iov_len)
+            {
+                left -= pending->iov_len;
+                ++pending;
+                --count;
+            }
+            if (count > 0)
+            {
+                pending->iov_base = static_cast<std::byte*>(pending->iov_base) + left;
+                pending->iov_len -= left;
+            }
+        }
+        if (::fdatasync(m_fd) != 0) { detail::abort_errno("journal fdatasync"); }
+    }
+
+    // Calls apply(version, command) for every command of the complete frames
+    // of the journal at path, in order, e.g. to bring a restored snapshot up
+    // to date. Returns the version of the last complete frame, or 0 if there
+    // is none.
+    template <typename Apply>
+    static uint64_t
+    replay(std::filesystem::path const& path, Apply&& apply)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == ENOENT) { return 0; }
+            detail::throw_errno("journal open");
+        }
+        std::vector<std::byte> contents;
+        try
+        {
+            contents = read_all(fd);
+        }
+        catch (...)
+        {
+            ::close(fd);
+            throw;
+        }
+        ::close(fd);
+        return scan(contents, apply).first;
+    }
+
+private:
+    struct Frame
+    {
+        uint64_t version;
+        uint64_t count;
+        uint64_t checksum;
+    };
+
+    int      m_fd;
+    uint64_t m_base = 0;
+
+    static std::vector<std::byte>
+    read_all(int fd)
+    {
+        std::vector<std::byte> contents;
+        std::byte              chunk[1 << 16];
+        ssize_t                n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) != 0)
+        {
+            if (n < 0)
+            {
+                if (errno == EINTR) { continue; }
+                detail::throw_errno("journal read");
+            }
+            contents.insert(contents.end(), chunk, chunk + n);
+        }
+        return contents;
+    }
+
+    // Calls apply(version, command) for the commands of the complete frames
+    // at the start of contents. Returns the version of the last one, or 0,
+    // and the offset it ends at.
+    template <typename Apply>
+    static std::pair<uint64_t, std::size_t>
+    scan(std::vector<std::byte> const& contents, Apply&& apply)
+    {
+        uint64_t             last   = 0;
+        std::size_t          offset = 0;
+        std::vector<Command> commands;
+        while (contents.size() - offset >= sizeof(Frame))
+        {
+            Frame frame;
+            std::memcpy(&frame, contents.data() + offset, sizeof(Frame));
+            std::size_t available = contents.size() - offset - sizeof(Frame);
+            if (frame.count > available / sizeof(Command)) { break; }
+
+            commands.resize(frame.count);
+            std::memcpy(
+                commands.data(),
+                contents.data() + offset + sizeof(Frame),
+                frame.count * sizeof(Command)
+            );
+            if (checksum(commands) != frame.checksum) { break; }
+            for (auto const& command : commands)
+            {
+                apply(frame.version, command);
+            }
+            last = frame.version;
+            offset += sizeof(Frame) + frame.count * sizeof(Command);
+        }
+        return {last, offset};
+    }
+
+    // FNV-1a over the commands, enough to tell a torn frame from a complete
+    // one.
+    static uint64_t
+    checksum(std::span<Command const> commands) noexcept
+    {
+        uint64_t hash  = 0xcbf29ce484222325;
+        auto     bytes = std::as_bytes(commands);
+        for (std::byte b : bytes)
+        {
+            hash = (hash ^ static_cast<uint64_t>(b)) * 0x100000001b3;
+        }
+        return hash;
+    }
+};
+
+} // namespace wbrcu
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace wbrcu
+{
+
+// Lazily computed value derived from the object that holds it, e.g. a sorted
+// view or a compiled matcher of a version of T protected by rcu_protected:
+//
+//     struct Config
+//     {
+//         std::vector<Rule>        rules;
+//         wbrcu::memoized<Matcher> matcher;
+//     };
+//
+//     auto config = rp.get_ptr();
+//     Matcher const& m = config->matcher.get(
+//         [&] { return Matcher{config->rules}; });
+//
+// The first reader of a version computes the value and installs it with a
+// CAS, later readers of that version reuse it. Readers racing on an empty
+// attachment may each compute it, only one value is kept.
+//
+// Copying or assigning resets the attachment, so the updater's copy of T
+// starts without one and the value is never carried over to a version it was
+// not computed from. It is freed with the version that holds it, when that is
+// destroyed or recycled by the updater.
+template <typename V>
+class memoized
+{
+public:
+    memoized() = default;
+
+    memoized(memoized const&) noexcept {}
+
+    memoized&
+    operator=(memoized const&) noexcept
+    {
+        reset();
+        return *this;
+    }
+
+    ~memoized() { reset(); }
+
+    // Returns the attached value, computing it with compute if there is none
+    // yet.
+    template <std::invocable Compute>
+        requires std::constructible_from<V, std::invoke_result_t<Compute>>
+    V const&
+    get(Compute&& compute) const
+    {
+        if (V const* value = peek()) { return *value; }
+
+        auto computed =
+            std::make_unique<V>(std::invoke(std::forward<Compute>(compute)));
+        V* expected = nullptr;
+        if (m_value.compare_exchange_strong(
+                expected,
+                computed.get(),
+                std::memory_order_acq_rel,
+                std::memory_order_acquire
+            ))
+        {
+            return *computed.release();
+        }
+        // Another reader installed its value first.
+        return *expected;
+    }
+
+    // Returns the attached value, or nullptr if it has not been computed.
+    V const*
+    peek() const noexcept
+    {
+        return m_value.load(std::memory_order_acquire);
+    }
+
+private:
+    mutable std::atomic<V*> m_value{nullptr};
+
+    // Only called when no reader can access the holder.
+    void
+    reset() noexcept
+    {
+        delete m_value.exchange(nullptr, std::memory_order_relaxed);
+    }
+};
+
+} // namespace wbrcu
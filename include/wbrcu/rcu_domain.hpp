@@ -0,0 +1,272 @@
+#pragma once
+
+#include "detail/ThreadCachedReaders.hpp"
+#include "folly/Function.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+template <typename T, uint64_t TagId>
+struct ThreadLocalTag
+{
+};
+
+// Reader registry and epoch shared by the RCU objects attached to it.
+//
+// Readers enter a read-side critical section with lock() and leave it with
+// unlock(). A reader records the parity of the epoch it entered in, so an
+// object retired in epoch e can be reclaimed once the epoch has advanced to
+// e + 2: advancing from e + 1 requires every reader of epoch e to have left.
+//
+// Every rcu_protected owns a domain by default. Instances constructed with the
+// same domain share its reader registry, so a single critical section covers
+// all of them.
+//
+// Pointers published by other means can be reclaimed through the domain as
+// well, with retire or call_after_grace_period, so that one reader registry
+// covers every RCU object of the application.
+template <uint64_t TagId = 0>
+class rcu_domain
+{
+    // One tag per TagId rather than per protected T: a domain is shared by
+    // objects of different types, e.g. in update_together, so its type cannot
+    // depend on T. All domains of a TagId share folly's thread-local registry
+    // and the lock of its accessAllThreads in try_advance, objects whose
+    // updaters must not contend on it can use distinct TagIds.
+    using Tag      = ThreadLocalTag<rcu_domain, TagId>;
+    using Callback = folly::Function<void()>;
+
+public:
+    rcu_domain() = default;
+
+    rcu_domain(rcu_domain const&)            = delete;
+    rcu_domain& operator=(rcu_domain const&) = delete;
+
+    // No reader may be left when the domain is destroyed, so the pending
+    // callbacks are run right away.
+    ~rcu_domain()
+    {
+        for (auto& callbacks : m_callbacks)
+        {
+            for (auto& callback : callbacks) { callback(); }
+        }
+    }
+
+    // Enter a read-side critical section. Critical sections of a thread may
+    // be nested up to detail::max_read_depth levels.
+    void
+    lock() noexcept
+    {
+        m_counters.increment(m_epoch.load(std::memory_order_relaxed) & 1);
+    }
+
+    void
+    unlock() noexcept
+    {
+        m_counters.decrement();
+    }
+
+    // Like lock, but returns the reader slot of the calling thread so that
+    // the critical section can be left with detail::reader_unlock on it
+    // without looking the slot up again.
+    detail::EpochReading&
+    lock_local() noexcept
+    {
+        auto& reading = m_counters.local();
+        detail::reader_lock(reading, m_epoch.load(std::memory_order_relaxed) & 1);
+        return reading;
+    }
+
+    uint64_t
+    epoch() const noexcept
+    {
+        return m_epoch.load(std::memory_order_relaxed);
+    }
+
+    // Advance the current epoch past epoch if no reader is left in the epoch
+    // before it. Returns whether the current epoch is now past epoch, which is
+    // also the case if another updater advanced it first.
+    bool
+    try_advance(uint64_t epoch)
+    {
+        if (!m_counters.epochIsClear((epoch - 1) & 1))
+        {
+            return m_epoch.load(std::memory_order_relaxed) != epoch;
+        }
+        m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Invoke callback once every reader that may be in a read-side critical
+    // section now has left it. Callbacks are run in batches by whichever
+    // thread retires when a batch becomes ready, by poll, or by barrier.
+    void
+    call_after_grace_period(Callback callback)
+    {
+        constexpr static std::size_t batchThreshold = 64;
+
+        std::vector<Callback> ready;
+        {
+            std::scoped_lock lock{m_callbackMutex};
+            uint64_t         epoch = m_epoch.load(std::memory_order_relaxed);
+            collect(epoch, ready);
+
+            bool curr = epoch & 1;
+            m_callbackEpochs[curr] = epoch;
+            m_callbacks[curr].push_back(std::move(callback));
+            m_callbackCnt.fetch_add(1, std::memory_order_relaxed);
+
+            if (m_callbacks[curr].size() >= batchThreshold && try_advance(epoch))
+            {
+                collect(m_epoch.load(std::memory_order_relaxed), ready);
+            }
+        }
+        for (auto& callback : ready) { callback(); }
+    }
+
+    // Reclaim ptr with deleter after the grace period.
+    template <typename T, typename Deleter = std::default_delete<T>>
+    void
+    retire(T* ptr, Deleter deleter = {})
+    {
+        call_after_grace_period(
+            [ptr, deleter = std::move(deleter)]() mutable { deleter(ptr); }
+        );
+    }
+
+    // Publishing several objects of the domain as one change, e.g. in
+    // update_together, happens between lock_publish and unlock_publish, which
+    // make the publish sequence odd while the pointers are being swapped.
+    void
+    lock_publish()
+    {
+        m_publishMutex.lock();
+        m_publishSeq.store(
+            m_publishSeq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed
+        );
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void
+    unlock_publish()
+    {
+        m_publishSeq.store(
+            m_publishSeq.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release
+        );
+        m_publishMutex.unlock();
+    }
+
+    // Readers loading several objects of the domain as one snapshot read the
+    // sequence with publish_seq first, then load the pointers, and retry if
+    // publish_retry returns true.
+    uint64_t
+    publish_seq() const noexcept
+    {
+        uint64_t seq;
+        while ((seq = m_publishSeq.load(std::memory_order_acquire)) & 1)
+        {
+            std::this_thread::yield();
+        }
+        return seq;
+    }
+
+    bool
+    publish_retry(uint64_t seq) const noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_publishSeq.load(std::memory_order_relaxed) != seq;
+    }
+
+    // Advance the epoch if no reader holds it back and invoke the callbacks
+    // whose grace period has elapsed, without waiting for readers. The
+    // updaters of rcu_protected poll whenever they advance the epoch; poll
+    // can also be called from an event loop to drive the callbacks when there
+    // are no updates.
+    void
+    poll()
+    {
+        if (!m_callbackCnt.load(std::memory_order_relaxed)) { return; }
+
+        std::vector<Callback> ready;
+        {
+            std::scoped_lock lock{m_callbackMutex};
+            try_advance(m_epoch.load(std::memory_order_relaxed));
+            collect(m_epoch.load(std::memory_order_relaxed), ready);
+        }
+        for (auto& callback : ready) { callback(); }
+    }
+
+    // Wait for a grace period and invoke every callback registered before the
+    // call. Must not be called inside a read-side critical section of this
+    // domain.
+    void
+    barrier()
+    {
+        uint64_t curr   = m_epoch.load(std::memory_order_relaxed);
+        uint64_t target = curr + 2;
+        while (curr < target)
+        {
+            if (!try_advance(curr)) { std::this_thread::yield(); }
+            curr = m_epoch.load(std::memory_order_relaxed);
+        }
+
+        std::vector<Callback> ready;
+        {
+            std::scoped_lock lock{m_callbackMutex};
+            collect(m_epoch.load(std::memory_order_relaxed), ready);
+        }
+        for (auto& callback : ready) { callback(); }
+    }
+
+private:
+    // Current epoch, only its parity is recorded by readers.
+    std::atomic<uint64_t> m_epoch{0};
+    // Counters for readers, each thread has a thread_local counter, it avoids
+    // reader contention that std::shared_mutex has.
+    detail::ThreadCachedReaders<Tag> m_counters;
+
+    // Sequence of multi-object publishes, odd while one is in progress.
+    std::atomic<uint64_t> m_publishSeq{0};
+    // Serializes multi-object publishes.
+    std::mutex m_publishMutex;
+
+    // Callbacks waiting for their grace period. m_callbacks[e & 1] holds the
+    // callbacks registered in epoch m_callbackEpochs[e & 1], like the retire
+    // lists of rcu_protected, but shared by all threads and guarded by
+    // m_callbackMutex.
+    std::mutex                           m_callbackMutex;
+    std::array<std::vector<Callback>, 2> m_callbacks;
+    std::array<uint64_t, 2>              m_callbackEpochs{};
+    // Number of callbacks waiting, lets poll skip the lock when there is none.
+    std::atomic<std::size_t> m_callbackCnt{0};
+
+    // Move the callbacks registered at least two epochs before epoch to ready.
+    void
+    collect(uint64_t epoch, std::vector<Callback>& ready)
+    {
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            auto& callbacks = m_callbacks[i];
+            if (callbacks.empty() || m_callbackEpochs[i] + 2 > epoch) { continue; }
+            ready.insert(
+                ready.end(),
+                std::make_move_iterator(callbacks.begin()),
+                std::make_move_iterator(callbacks.end())
+            );
+            m_callbackCnt.fetch_sub(callbacks.size(), std::memory_order_relaxed);
+            callbacks.clear();
+        }
+    }
+};
+
+} // namespace wbrcu
@@ -0,0 +1,424 @@
+#pragma once
+
+#include "detail/UpdateBatcher.hpp"
+#include "rcu_domain.hpp"
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+template <typename T, uint64_t TagId, uint64_t flushingThreshold>
+class rcu_list;
+
+template <typename T>
+class rcu_list_writer;
+
+template <typename T>
+class rcu_list_view;
+
+// Links embedded in every element of an rcu_list. T derives from
+// rcu_list_hook<T>. Copying a hook does not copy its links.
+template <typename T>
+class rcu_list_hook
+{
+public:
+    rcu_list_hook() = default;
+
+    rcu_list_hook(rcu_list_hook const&) noexcept {}
+
+    rcu_list_hook&
+    operator=(rcu_list_hook const&) noexcept
+    {
+        return *this;
+    }
+
+private:
+    friend class rcu_list_view<T>;
+    friend class rcu_list_writer<T>;
+
+    // Next element, read by readers.
+    std::atomic<T*> m_next{nullptr};
+    // Previous element, only accessed by the updater.
+    T* m_prev = nullptr;
+};
+
+// Read-side interface of an rcu_list, a forward range of T const.
+template <typename T>
+class rcu_list_view
+{
+public:
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = T;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = T const*;
+        using reference         = T const&;
+
+        const_iterator() = default;
+
+        explicit const_iterator(T const* node) noexcept : m_node{node} {}
+
+        reference
+        operator*() const noexcept
+        {
+            return *m_node;
+        }
+
+        pointer
+        operator->() const noexcept
+        {
+            return m_node;
+        }
+
+        const_iterator&
+        operator++() noexcept
+        {
+            m_node = next_of(m_node);
+            return *this;
+        }
+
+        const_iterator
+        operator++(int) noexcept
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool
+        operator==(const_iterator const&, const_iterator const&) noexcept = default;
+
+    private:
+        T const* m_node = nullptr;
+    };
+
+    rcu_list_view() = default;
+
+    rcu_list_view(rcu_list_view const&)            = delete;
+    rcu_list_view& operator=(rcu_list_view const&) = delete;
+
+    const_iterator
+    begin() const noexcept
+    {
+        return const_iterator{m_head.load(std::memory_order_acquire)};
+    }
+
+    const_iterator
+    end() const noexcept
+    {
+        return {};
+    }
+
+    bool
+    empty() const noexcept
+    {
+        return m_head.load(std::memory_order_relaxed) == nullptr;
+    }
+
+protected:
+    // First element. Writers publish an insertion or removal with a single
+    // release store to m_head or to the predecessor's m_next.
+    std::atomic<T*> m_head{nullptr};
+
+    static T*
+    next_of(T const* node) noexcept
+    {
+        return static_cast<rcu_list_hook<T> const*>(node)->m_next.load(
+            std::memory_order_acquire
+        );
+    }
+};
+
+// Update-side interface of an rcu_list, passed to update callbacks.
+//
+// Unlike rcu_protected, the updater does not modify a private copy: every
+// insertion and removal is linked into the live list right away, which is
+// safe because readers only ever follow m_next and a removed element keeps
+// its m_next until it is reclaimed. Elements must not be modified in place,
+// use replace to publish a new value.
+template <typename T>
+class rcu_list_writer : public rcu_list_view<T>
+{
+    template <typename, uint64_t, uint64_t>
+    friend class rcu_list;
+
+public:
+    template <typename... Args>
+    T*
+    emplace_front(Args&&... args)
+    {
+        return link(nullptr, make(std::forward<Args>(args)...));
+    }
+
+    template <typename... Args>
+    T*
+    emplace_back(Args&&... args)
+    {
+        return link(m_tail, make(std::forward<Args>(args)...));
+    }
+
+    // Inserts a new element right after pos, which must be in the list.
+    template <typename... Args>
+    T*
+    emplace_after(T const* pos, Args&&... args)
+    {
+        return link(const_cast<T*>(pos), make(std::forward<Args>(args)...));
+    }
+
+    // Unlinks node, which must be in the list. It is destroyed after the
+    // grace period.
+    void
+    erase(T const* node)
+    {
+        auto* unlinked = const_cast<T*>(node);
+        T*    prev     = hook(unlinked).m_prev;
+        T*    next     = hook(unlinked).m_next.load(std::memory_order_relaxed);
+        (prev ? hook(prev).m_next : this->m_head)
+            .store(next, std::memory_order_release);
+        (next ? hook(next).m_prev : m_tail) = prev;
+        m_unlinked.push_back(unlinked);
+        --m_size;
+    }
+
+    // Replaces node, which must be in the list, with a new element
+    // constructed from args. Readers see either node or the new element.
+    template <typename... Args>
+    T*
+    replace(T const* node, Args&&... args)
+    {
+        auto* old  = const_cast<T*>(node);
+        T*    prev = hook(old).m_prev;
+        T*    next = hook(old).m_next.load(std::memory_order_relaxed);
+        T*    made = make(std::forward<Args>(args)...);
+        hook(made).m_prev = prev;
+        hook(made).m_next.store(next, std::memory_order_relaxed);
+        (prev ? hook(prev).m_next : this->m_head)
+            .store(made, std::memory_order_release);
+        (next ? hook(next).m_prev : m_tail) = made;
+        m_unlinked.push_back(old);
+        return made;
+    }
+
+    // Erases every element for which pred returns true, returns the count.
+    template <std::predicate<T const&> Pred>
+    std::size_t
+    erase_if(Pred pred)
+    {
+        std::size_t erased = 0;
+        for (T* node = this->m_head.load(std::memory_order_relaxed); node;)
+        {
+            T* next = hook(node).m_next.load(std::memory_order_relaxed);
+            if (pred(std::as_const(*node)))
+            {
+                erase(node);
+                ++erased;
+            }
+            node = next;
+        }
+        return erased;
+    }
+
+    std::size_t
+    size() const noexcept
+    {
+        return m_size;
+    }
+
+private:
+    // Last element, for emplace_back.
+    T*          m_tail = nullptr;
+    std::size_t m_size = 0;
+    // Elements unlinked since the last publish.
+    std::vector<T*> m_unlinked;
+    // Storage of reclaimed elements, already destroyed. We don't deallocate
+    // all of it immediately, instead, we use it as the object pool to reuse
+    // the allocated memory.
+    std::vector<T*> m_finished;
+
+    // Storage the domain's grace-period callbacks hand back, which run on
+    // whichever thread drives the domain. Shared with the pending callbacks,
+    // so that a list attached to a shared domain may be destroyed first.
+    struct Reclaimed
+    {
+        std::mutex      mutex;
+        std::vector<T*> storage;
+
+        ~Reclaimed() { deallocate(storage); }
+    };
+
+    std::shared_ptr<Reclaimed> m_reclaimed = std::make_shared<Reclaimed>();
+
+    rcu_list_writer() = default;
+
+    ~rcu_list_writer()
+    {
+        for (T* node = this->m_head.load(std::memory_order_relaxed); node;)
+        {
+            T* next = hook(node).m_next.load(std::memory_order_relaxed);
+            destroy(node);
+            node = next;
+        }
+        for (auto p : m_unlinked) { destroy(p); }
+        deallocate(m_finished);
+    }
+
+    static rcu_list_hook<T>&
+    hook(T* node) noexcept
+    {
+        return *static_cast<rcu_list_hook<T>*>(node);
+    }
+
+    template <typename... Args>
+    T*
+    make(Args&&... args)
+    {
+        if (m_finished.empty())
+        {
+            std::scoped_lock lock{m_reclaimed->mutex};
+            std::swap(m_finished, m_reclaimed->storage);
+        }
+        T* storage;
+        if (m_finished.empty())
+        {
+            storage = std::allocator<T>{}.allocate(1);
+        }
+        else
+        {
+            storage = m_finished.back();
+            m_finished.pop_back();
+        }
+        return std::construct_at(storage, std::forward<Args>(args)...);
+    }
+
+    // Links node after prev, or at the front if prev is nullptr.
+    T*
+    link(T* prev, T* node)
+    {
+        auto& prevNext = prev ? hook(prev).m_next : this->m_head;
+        T*    next     = prevNext.load(std::memory_order_relaxed);
+        hook(node).m_prev = prev;
+        hook(node).m_next.store(next, std::memory_order_relaxed);
+        prevNext.store(node, std::memory_order_release);
+        (next ? hook(next).m_prev : m_tail) = node;
+        ++m_size;
+        return node;
+    }
+
+    static void
+    destroy(T* node) noexcept
+    {
+        std::destroy_at(node);
+        std::allocator<T>{}.deallocate(node, 1);
+    }
+
+    static void
+    deallocate(std::vector<T*>& storage) noexcept
+    {
+        for (auto p : storage) { std::allocator<T>{}.deallocate(p, 1); }
+        storage.clear();
+    }
+};
+
+// Intrusive list for large collections updated one element at a time. Readers
+// only follow the forward links, the back links are for the updater.
+//
+// Updates go through the same batching front end as rcu_protected, so writers
+// still serialize on a single updater, but an insertion or removal is
+// published with one pointer store instead of a copy of the whole list. Only
+// the unlinked elements are retired, through rcu_domain's grace-period
+// callbacks, and their storage is pooled for later insertions.
+//
+// T must derive from rcu_list_hook<T>.
+template <typename T, uint64_t TagId = 0, uint64_t flushingThreshold = 20>
+class rcu_list
+    : public detail::UpdateBatcher<
+          rcu_list<T, TagId, flushingThreshold>,
+          rcu_list_writer<T>,
+          flushingThreshold>
+{
+    friend class detail::
+        UpdateBatcher<rcu_list, rcu_list_writer<T>, flushingThreshold>;
+
+    static_assert(std::is_base_of_v<rcu_list_hook<T>, T>);
+
+public:
+    using domain_type = rcu_domain<TagId>;
+    using view_type   = rcu_list_view<T>;
+    using writer_type = rcu_list_writer<T>;
+
+    rcu_list() : m_ownDomain{std::in_place}, m_domain{&*m_ownDomain} {}
+
+    // Attach to a domain shared with other RCU objects instead of owning one.
+    // domain must outlive this object.
+    explicit rcu_list(domain_type& domain) : m_domain{&domain} {}
+
+    // Returns a protected view of the list that will automatically unlock
+    // when destroyed. Read locks may be nested, see rcu_domain::lock.
+    auto
+    get_ptr() noexcept
+    {
+        m_domain->lock();
+        auto deleter = [&](view_type const*) { m_domain->unlock(); };
+        return std::unique_ptr<view_type const, decltype(deleter)>(
+            &m_writer, deleter
+        );
+    }
+
+    domain_type&
+    domain() const noexcept
+    {
+        return *m_domain;
+    }
+
+private:
+    // Domain owned by this object, unless it is attached to a shared one.
+    std::optional<domain_type> m_ownDomain;
+    // Domain holding the reader registry and the epoch.
+    domain_type* m_domain;
+    // The list itself, modified only by the updater.
+    writer_type m_writer;
+
+    writer_type*
+    get_copy() noexcept
+    {
+        return &m_writer;
+    }
+
+    // Every change is already visible to readers, retire the elements the
+    // batch unlinked as one callback of the domain, which destroys them and
+    // hands their storage back to the writer's pool. Polling after every
+    // batch, as rcu_protected's updaters do, lets the elements of earlier
+    // batches come back to the pool as soon as their grace period has
+    // elapsed.
+    void
+    publish(writer_type* writer)
+    {
+        if (!writer->m_unlinked.empty())
+        {
+            m_domain->call_after_grace_period(
+                [nodes     = std::exchange(writer->m_unlinked, {}),
+                 reclaimed = writer->m_reclaimed]() mutable
+                {
+                    for (auto p : nodes) { std::destroy_at(p); }
+                    std::scoped_lock lock{reclaimed->mutex};
+                    reclaimed->storage.insert(
+                        reclaimed->storage.end(), nodes.begin(), nodes.end()
+                    );
+                }
+            );
+        }
+        m_domain->poll();
+    }
+};
+
+} // namespace wbrcu
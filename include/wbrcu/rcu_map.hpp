@@ -0,0 +1,369 @@
+#pragma once
+
+#include "rcu_protected.hpp"
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace wbrcu
+{
+
+// Persistent hash array mapped trie.
+//
+// Nodes are immutable once created and shared between copies, so copying a
+// hamt is O(1) and an update path-copies only the O(log n) nodes from the root
+// to the touched entry. A node is freed when the last hamt referencing it is
+// destroyed or overwritten.
+template <
+    typename K,
+    typename V,
+    typename Hash     = std::hash<K>,
+    typename KeyEqual = std::equal_to<K>>
+class hamt
+{
+public:
+    // Returns a pointer to the value mapped to key, or nullptr if there is
+    // none. The pointer stays valid as long as this hamt is not modified.
+    V const*
+    find(K const& key) const
+    {
+        auto        hash = m_hash(key);
+        Node const* node = m_root.get();
+        for (std::size_t shift = 0; node; shift += bitsPerLevel)
+        {
+            if (shift >= hashBits) { return find_collision(*node, key); }
+
+            auto bit = bit_of(hash, shift);
+            if (!(node->bitmap & bit)) { return nullptr; }
+
+            auto const& slot = node->slots[index_of(node->bitmap, bit)];
+            if (auto const* entry = std::get_if<Entry>(&slot))
+            {
+                return entry->hash == hash && m_equal(entry->key, key)
+                         ? &entry->value
+                         : nullptr;
+            }
+            node = std::get<NodePtr>(slot).get();
+        }
+        return nullptr;
+    }
+
+    bool
+    contains(K const& key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    // Returns true if key was inserted, false if its value was replaced.
+    bool
+    insert_or_assign(K key, V value)
+    {
+        bool inserted = false;
+        auto hash     = m_hash(key);
+        m_root        = insert(
+            m_root, 0, Entry{hash, std::move(key), std::move(value)}, inserted
+        );
+        m_size += inserted;
+        return inserted;
+    }
+
+    // Returns true if key was erased.
+    bool
+    erase(K const& key)
+    {
+        bool erased = false;
+        m_root      = erase(m_root, 0, m_hash(key), key, erased);
+        m_size -= erased;
+        return erased;
+    }
+
+    void
+    clear() noexcept
+    {
+        m_root.reset();
+        m_size = 0;
+    }
+
+    std::size_t
+    size() const noexcept
+    {
+        return m_size;
+    }
+
+    bool
+    empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+    // Calls f(key, value) for every entry, in unspecified order.
+    template <std::invocable<K const&, V const&> F>
+    void
+    for_each(F&& f) const
+    {
+        if (m_root) { visit(*m_root, f); }
+    }
+
+private:
+    static constexpr std::size_t bitsPerLevel = 5;
+    static constexpr std::size_t hashBits     = sizeof(std::size_t) * 8;
+
+    struct Node;
+    using NodePtr = std::shared_ptr<Node const>;
+
+    struct Entry
+    {
+        std::size_t hash;
+        K           key;
+        V           value;
+    };
+
+    using Slot = std::variant<Entry, NodePtr>;
+
+    // Slots are stored compressed, ordered by their index in bitmap. Below
+    // the last level a node holds the entries whose hashes fully collide, and
+    // bitmap is unused.
+    struct Node
+    {
+        uint32_t          bitmap = 0;
+        std::vector<Slot> slots;
+    };
+
+    NodePtr                        m_root;
+    std::size_t                    m_size = 0;
+    [[no_unique_address]] Hash     m_hash;
+    [[no_unique_address]] KeyEqual m_equal;
+
+    static uint32_t
+    bit_of(std::size_t hash, std::size_t shift) noexcept
+    {
+        return uint32_t{1} << ((hash >> shift) & ((1u << bitsPerLevel) - 1));
+    }
+
+    static std::size_t
+    index_of(uint32_t bitmap, uint32_t bit) noexcept
+    {
+        return std::popcount(bitmap & (bit - 1));
+    }
+
+    V const*
+    find_collision(Node const& node, K const& key) const
+    {
+        for (auto const& slot : node.slots)
+        {
+            auto const& entry = std::get<Entry>(slot);
+            if (m_equal(entry.key, key)) { return &entry.value; }
+        }
+        return nullptr;
+    }
+
+    // Returns the node with entry inserted into the subtree rooted at node.
+    NodePtr
+    insert(NodePtr const& node, std::size_t shift, Entry&& entry, bool& inserted)
+    {
+        auto copy = node ? std::make_shared<Node>(*node)
+                         : std::make_shared<Node>();
+        if (shift >= hashBits)
+        {
+            for (auto& slot : copy->slots)
+            {
+                auto& existing = std::get<Entry>(slot);
+                if (m_equal(existing.key, entry.key))
+                {
+                    existing.value = std::move(entry.value);
+                    return copy;
+                }
+            }
+            copy->slots.emplace_back(std::move(entry));
+            inserted = true;
+            return copy;
+        }
+
+        auto bit = bit_of(entry.hash, shift);
+        auto pos = index_of(copy->bitmap, bit);
+        if (!(copy->bitmap & bit))
+        {
+            copy->bitmap |= bit;
+            copy->slots.emplace(copy->slots.begin() + pos, std::move(entry));
+            inserted = true;
+            return copy;
+        }
+
+        auto& slot = copy->slots[pos];
+        if (auto* existing = std::get_if<Entry>(&slot))
+        {
+            if (existing->hash == entry.hash
+                && m_equal(existing->key, entry.key))
+            {
+                existing->value = std::move(entry.value);
+                return copy;
+            }
+
+            // Push both entries down one level.
+            bool    ignored = false;
+            NodePtr child =
+                insert(nullptr, shift + bitsPerLevel, std::move(*existing), ignored);
+            slot = insert(child, shift + bitsPerLevel, std::move(entry), inserted);
+        }
+        else
+        {
+            slot = insert(
+                std::get<NodePtr>(slot),
+                shift + bitsPerLevel,
+                std::move(entry),
+                inserted
+            );
+        }
+        return copy;
+    }
+
+    // Returns the node with key erased from the subtree rooted at node, which
+    // is node itself if key is absent and nullptr if the subtree is now empty.
+    NodePtr
+    erase(
+        NodePtr const& node,
+        std::size_t    shift,
+        std::size_t    hash,
+        K const&       key,
+        bool&          erased
+    )
+    {
+        if (!node) { return node; }
+
+        if (shift >= hashBits)
+        {
+            for (std::size_t i = 0; i < node->slots.size(); ++i)
+            {
+                if (m_equal(std::get<Entry>(node->slots[i]).key, key))
+                {
+                    erased = true;
+                    if (node->slots.size() == 1) { return nullptr; }
+                    auto copy = std::make_shared<Node>(*node);
+                    copy->slots.erase(copy->slots.begin() + i);
+                    return copy;
+                }
+            }
+            return node;
+        }
+
+        auto bit = bit_of(hash, shift);
+        if (!(node->bitmap & bit)) { return node; }
+
+        auto        pos  = index_of(node->bitmap, bit);
+        auto const& slot = node->slots[pos];
+        NodePtr     newChild;
+        if (auto const* entry = std::get_if<Entry>(&slot))
+        {
+            if (entry->hash != hash || !m_equal(entry->key, key)) { return node; }
+            erased = true;
+        }
+        else
+        {
+            auto const& child = std::get<NodePtr>(slot);
+            newChild = erase(child, shift + bitsPerLevel, hash, key, erased);
+            if (newChild == child) { return node; }
+        }
+
+        if (!newChild && node->slots.size() == 1) { return nullptr; }
+
+        auto copy = std::make_shared<Node>(*node);
+        if (!newChild)
+        {
+            copy->bitmap &= ~bit;
+            copy->slots.erase(copy->slots.begin() + pos);
+        }
+        else if (newChild->slots.size() == 1
+                 && std::holds_alternative<Entry>(newChild->slots.front()))
+        {
+            // Pull a lone entry up so that lookups stay short.
+            copy->slots[pos] = std::get<Entry>(newChild->slots.front());
+        }
+        else { copy->slots[pos] = std::move(newChild); }
+        return copy;
+    }
+
+    template <typename F>
+    static void
+    visit(Node const& node, F& f)
+    {
+        for (auto const& slot : node.slots)
+        {
+            if (auto const* entry = std::get_if<Entry>(&slot))
+            {
+                f(entry->key, entry->value);
+            }
+            else { visit(*std::get<NodePtr>(slot), f); }
+        }
+    }
+};
+
+// Read-mostly hash map built on rcu_protected.
+//
+// Each version is a hamt, so the updater's copy in get_copy is O(1) and a
+// batch of updates path-copies only the nodes it touches instead of the whole
+// map. Nodes dropped by an update stay reachable from the retired version
+// until rcu_protected reclaims or reuses it after the grace period, so node
+// reclamation follows the same epochs as the versions themselves.
+template <
+    typename K,
+    typename V,
+    typename Hash              = std::hash<K>,
+    typename KeyEqual          = std::equal_to<K>,
+    uint64_t TagId             = 0,
+    uint64_t flushingThreshold = 20>
+class rcu_map
+{
+public:
+    using map_type = hamt<K, V, Hash, KeyEqual>;
+
+    rcu_map() : m_protected{new map_type{}} {}
+
+    // Returns a protected pointer to the current version of the map, see
+    // rcu_protected::get_ptr.
+    auto
+    get_ptr() noexcept
+    {
+        return m_protected.get_ptr();
+    }
+
+    std::optional<V>
+    find(K const& key)
+    {
+        auto ptr = get_ptr();
+        if (auto const* value = ptr->find(key)) { return *value; }
+        return std::nullopt;
+    }
+
+    template <std::invocable<map_type*> UpdateFunc>
+    void
+    update(UpdateFunc&& updateCallback)
+    {
+        m_protected.update(std::forward<UpdateFunc>(updateCallback));
+    }
+
+    void
+    insert_or_assign(K key, V value)
+    {
+        update(
+            [key = std::move(key), value = std::move(value)](map_type* map
+            ) mutable { map->insert_or_assign(std::move(key), std::move(value)); }
+        );
+    }
+
+    void
+    erase(K key)
+    {
+        update([key = std::move(key)](map_type* map) { map->erase(key); });
+    }
+
+private:
+    rcu_protected<map_type, TagId, flushingThreshold> m_protected;
+};
+
+} // namespace wbrcu
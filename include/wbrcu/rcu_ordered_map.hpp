@@ -0,0 +1,454 @@
+#pragma once
+
+#include "rcu_protected.hpp"
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+// Persistent ordered map implemented as a treap with path copying.
+//
+// Nodes are immutable once created and shared between copies, so copying a
+// treap is O(1) and an update copies only the O(log n) expected nodes on the
+// path to the touched key. Readers traverse plain pointers and never wait.
+template <typename K, typename V, typename Compare = std::less<K>>
+class treap
+{
+    struct Node;
+    using NodePtr = std::shared_ptr<Node const>;
+
+    // Stack of nodes kept inline up to a depth that an expected O(log n)
+    // path does not reach, so that iterating does not allocate. Deeper nodes
+    // spill to the heap.
+    class Path
+    {
+        static constexpr std::size_t inline_depth = 48;
+
+    public:
+        bool
+        empty() const noexcept
+        {
+            return m_size == 0;
+        }
+
+        Node const*
+        back() const noexcept
+        {
+            return m_size <= inline_depth ? m_inline[m_size - 1] : m_spill.back();
+        }
+
+        void
+        push_back(Node const* node)
+        {
+            if (m_size < inline_depth) { m_inline[m_size] = node; }
+            else { m_spill.push_back(node); }
+            ++m_size;
+        }
+
+        void
+        pop_back() noexcept
+        {
+            if (m_size > inline_depth) { m_spill.pop_back(); }
+            --m_size;
+        }
+
+    private:
+        std::array<Node const*, inline_depth> m_inline{};
+        std::size_t                           m_size = 0;
+        std::vector<Node const*>              m_spill;
+    };
+
+public:
+    using key_type   = K;
+    using value_type = std::pair<K const, V>;
+
+    // In-order iterator. It stays valid as long as the treap it was obtained
+    // from is not modified.
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = treap::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = value_type const*;
+        using reference         = value_type const&;
+
+        const_iterator() = default;
+
+        reference
+        operator*() const noexcept
+        {
+            return m_path.back()->entry;
+        }
+
+        pointer
+        operator->() const noexcept
+        {
+            return &m_path.back()->entry;
+        }
+
+        const_iterator&
+        operator++()
+        {
+            // The successor is the leftmost node of the right subtree, or else
+            // the nearest ancestor we descended left from.
+            Node const* node = m_path.back();
+            m_path.pop_back();
+            push_leftmost(node->right.get());
+            return *this;
+        }
+
+        const_iterator
+        operator++(int)
+        {
+            auto copy = *this;
+            ++*this;
+            return copy;
+        }
+
+        friend bool
+        operator==(const_iterator const& lhs, const_iterator const& rhs) noexcept
+        {
+            if (lhs.m_path.empty() || rhs.m_path.empty())
+            {
+                return lhs.m_path.empty() == rhs.m_path.empty();
+            }
+            return lhs.m_path.back() == rhs.m_path.back();
+        }
+
+    private:
+        friend class treap;
+
+        // Ancestors of the current node whose entries come after it, ending
+        // with the current node. Empty for the end iterator.
+        Path m_path;
+
+        void
+        push_leftmost(Node const* node)
+        {
+            for (; node; node = node->left.get()) { m_path.push_back(node); }
+        }
+    };
+
+    treap() = default;
+
+    V const*
+    find(K const& key) const
+    {
+        Node const* node = m_root.get();
+        while (node)
+        {
+            if (m_less(key, node->entry.first)) { node = node->left.get(); }
+            else if (m_less(node->entry.first, key)) { node = node->right.get(); }
+            else { return &node->entry.second; }
+        }
+        return nullptr;
+    }
+
+    bool
+    contains(K const& key) const
+    {
+        return find(key) != nullptr;
+    }
+
+    const_iterator
+    begin() const
+    {
+        const_iterator it;
+        it.push_leftmost(m_root.get());
+        return it;
+    }
+
+    const_iterator
+    end() const noexcept
+    {
+        return {};
+    }
+
+    // Returns an iterator to the first entry whose key is not less than key.
+    const_iterator
+    lower_bound(K const& key) const
+    {
+        const_iterator it;
+        for (Node const* node = m_root.get(); node;)
+        {
+            if (m_less(node->entry.first, key)) { node = node->right.get(); }
+            else
+            {
+                it.m_path.push_back(node);
+                node = node->left.get();
+            }
+        }
+        return it;
+    }
+
+    // Returns an iterator to the first entry whose key is greater than key.
+    const_iterator
+    upper_bound(K const& key) const
+    {
+        const_iterator it;
+        for (Node const* node = m_root.get(); node;)
+        {
+            if (m_less(key, node->entry.first))
+            {
+                it.m_path.push_back(node);
+                node = node->left.get();
+            }
+            else { node = node->right.get(); }
+        }
+        return it;
+    }
+
+    // Calls f(key, value) for every entry with lo <= key < hi, in order.
+    // Subtrees outside of the range are skipped without being visited.
+    template <std::invocable<K const&, V const&> F>
+    void
+    for_each_in_range(K const& lo, K const& hi, F&& f) const
+    {
+        for_each_in_range(m_root.get(), lo, hi, f);
+    }
+
+    // Returns true if key was inserted, false if its value was replaced.
+    bool
+    insert_or_assign(K key, V value)
+    {
+        bool inserted = false;
+        m_root        = insert(
+            m_root, value_type{std::move(key), std::move(value)}, next_priority(), inserted
+        );
+        m_size += inserted;
+        return inserted;
+    }
+
+    // Returns true if key was erased.
+    bool
+    erase(K const& key)
+    {
+        bool erased = false;
+        m_root      = erase(m_root, key, erased);
+        m_size -= erased;
+        return erased;
+    }
+
+    void
+    clear() noexcept
+    {
+        m_root.reset();
+        m_size = 0;
+    }
+
+    std::size_t
+    size() const noexcept
+    {
+        return m_size;
+    }
+
+    bool
+    empty() const noexcept
+    {
+        return m_size == 0;
+    }
+
+private:
+    // Nodes form a binary search tree by key and a max-heap by priority.
+    struct Node
+    {
+        value_type entry;
+        uint64_t   priority;
+        NodePtr    left;
+        NodePtr    right;
+    };
+
+    NodePtr                       m_root;
+    std::size_t                   m_size = 0;
+    // State of the xorshift generator for node priorities.
+    uint64_t                      m_seed = 0x9e3779b97f4a7c15;
+    [[no_unique_address]] Compare m_less;
+
+    uint64_t
+    next_priority() noexcept
+    {
+        m_seed ^= m_seed << 13;
+        m_seed ^= m_seed >> 7;
+        m_seed ^= m_seed << 17;
+        return m_seed;
+    }
+
+    static NodePtr
+    make_node(value_type const& entry, uint64_t priority, NodePtr left, NodePtr right)
+    {
+        return std::make_shared<Node>(
+            Node{entry, priority, std::move(left), std::move(right)}
+        );
+    }
+
+    NodePtr
+    insert(NodePtr const& node, value_type&& entry, uint64_t priority, bool& inserted)
+    {
+        if (!node)
+        {
+            inserted = true;
+            return std::make_shared<Node>(
+                Node{std::move(entry), priority, nullptr, nullptr}
+            );
+        }
+
+        if (m_less(entry.first, node->entry.first))
+        {
+            auto left = insert(node->left, std::move(entry), priority, inserted);
+            if (left->priority > node->priority)
+            {
+                // Rotate right.
+                return make_node(
+                    left->entry,
+                    left->priority,
+                    left->left,
+                    make_node(node->entry, node->priority, left->right, node->right)
+                );
+            }
+            return make_node(node->entry, node->priority, std::move(left), node->right);
+        }
+
+        if (m_less(node->entry.first, entry.first))
+        {
+            auto right = insert(node->right, std::move(entry), priority, inserted);
+            if (right->priority > node->priority)
+            {
+                // Rotate left.
+                return make_node(
+                    right->entry,
+                    right->priority,
+                    make_node(node->entry, node->priority, node->left, right->left),
+                    right->right
+                );
+            }
+            return make_node(node->entry, node->priority, node->left, std::move(right));
+        }
+
+        return make_node(entry, node->priority, node->left, node->right);
+    }
+
+    template <typename F>
+    void
+    for_each_in_range(Node const* node, K const& lo, K const& hi, F& f) const
+    {
+        while (node)
+        {
+            bool const afterLo  = !m_less(node->entry.first, lo);
+            bool const beforeHi = m_less(node->entry.first, hi);
+            if (afterLo) { for_each_in_range(node->left.get(), lo, hi, f); }
+            if (afterLo && beforeHi) { f(node->entry.first, node->entry.second); }
+            // The right subtree is walked in place of a tail call.
+            node = beforeHi ? node->right.get() : nullptr;
+        }
+    }
+
+    // Join two treaps whose keys are all less in lhs than in rhs.
+    static NodePtr
+    merge(NodePtr const& lhs, NodePtr const& rhs)
+    {
+        if (!lhs) { return rhs; }
+        if (!rhs) { return lhs; }
+        if (lhs->priority > rhs->priority)
+        {
+            return make_node(lhs->entry, lhs->priority, lhs->left, merge(lhs->right, rhs));
+        }
+        return make_node(rhs->entry, rhs->priority, merge(lhs, rhs->left), rhs->right);
+    }
+
+    NodePtr
+    erase(NodePtr const& node, K const& key, bool& erased)
+    {
+        if (!node) { return node; }
+
+        if (m_less(key, node->entry.first))
+        {
+            auto left = erase(node->left, key, erased);
+            if (left == node->left) { return node; }
+            return make_node(node->entry, node->priority, std::move(left), node->right);
+        }
+
+        if (m_less(node->entry.first, key))
+        {
+            auto right = erase(node->right, key, erased);
+            if (right == node->right) { return node; }
+            return make_node(node->entry, node->priority, node->left, std::move(right));
+        }
+
+        erased = true;
+        return merge(node->left, node->right);
+    }
+};
+
+// Read-mostly ordered map built on rcu_protected, for point lookups and range
+// scans under heavy read load.
+//
+// Each version is a treap, so the updater's copy in get_copy is O(1) and a
+// batch of updates path-copies only the nodes it touches. Nodes dropped by an
+// update stay reachable from the retired version until rcu_protected reclaims
+// or reuses it after the grace period.
+template <
+    typename K,
+    typename V,
+    typename Compare           = std::less<K>,
+    uint64_t TagId             = 0,
+    uint64_t flushingThreshold = 20>
+class rcu_ordered_map
+{
+public:
+    using map_type = treap<K, V, Compare>;
+
+    rcu_ordered_map() : m_protected{new map_type{}} {}
+
+    // Returns a protected pointer to the current version of the map, see
+    // rcu_protected::get_ptr. Iterators obtained from it are valid until it is
+    // released.
+    auto
+    get_ptr() noexcept
+    {
+        return m_protected.get_ptr();
+    }
+
+    std::optional<V>
+    find(K const& key)
+    {
+        auto ptr = get_ptr();
+        if (auto const* value = ptr->find(key)) { return *value; }
+        return std::nullopt;
+    }
+
+    template <std::invocable<map_type*> UpdateFunc>
+    void
+    update(UpdateFunc&& updateCallback)
+    {
+        m_protected.update(std::forward<UpdateFunc>(updateCallback));
+    }
+
+    void
+    insert_or_assign(K key, V value)
+    {
+        update(
+            [key = std::move(key), value = std::move(value)](map_type* map
+            ) mutable { map->insert_or_assign(std::move(key), std::move(value)); }
+        );
+    }
+
+    void
+    erase(K key)
+    {
+        update([key = std::move(key)](map_type* map) { map->erase(key); });
+    }
+
+private:
+    rcu_protected<map_type, TagId, flushingThreshold> m_protected;
+};
+
+} // namespace wbrcu
@@ -1,21 +1,33 @@
 #pragma once
 
-#include "detail/ThreadCachedReaders.hpp"
-#include "folly/Function.h"
-#include "folly/MPMCQueue.h"
+#include "cloner.hpp"
+#include "config.hpp"
+#include "detail/Futex.hpp"
+#include "detail/UpdateBatcher.hpp"
+#include "detail/VersionHistory.hpp"
 #include "folly/synchronization/detail/ThreadCachedReaders.h"
+#include "journal.hpp"
+#include "rcu_domain.hpp"
+#include "read_guard.hpp"
+#include <algorithm>
 #include <array>
 #include <atomic>
-#include <concepts>
+#include <cassert>
+#include <chrono>
+#include <coroutine>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <source_location>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace wbrcu
 {
 
-inline constexpr uint64_t hardware_concurrency = WBRCU_HARDWARE_CONCURRENCY;
-
 // Generate compile-time random number with seeding from source location
 consteval uint64_t rand(std::source_location const& loc = std::source_location::current()) {
     // Combine line, column and file_name hash
@@ -32,100 +44,488 @@ consteval uint64_t rand(std::source_location const& loc = std::source_location::
     return seed ^ hash;
 }
 
-template <typename T, uint64_t TagId>
-struct ThreadLocalTag
+// What a publish hook of rcu_protected<T> receives after every publish.
+template <typename T, typename Update>
+struct publish_event
 {
+    // Object readers saw before the publish, and the one published.
+    T const* previous;
+    T const* current;
+    // version() of current.
+    uint64_t version;
+    // Commands applied to previous to make current, in order. Only recorded
+    // by command_protected, empty otherwise.
+    std::span<Update const> applied;
 };
 
-template <typename T, uint64_t TagId = 0, uint64_t flushingThreshold = 20>
+template <
+    typename T,
+    uint64_t      TagId             = 0,
+    uint64_t      flushingThreshold = 20,
+    cloner_for<T> Cloner            = default_cloner<T>,
+    typename Update                 = folly::Function<void(T*)>>
 class rcu_protected
+    : public detail::UpdateBatcher<
+          rcu_protected<T, TagId, flushingThreshold, Cloner, Update>,
+          T,
+          flushingThreshold,
+          Update>
 {
-    using Tag = ThreadLocalTag<T, TagId>;
+    friend class detail::
+        UpdateBatcher<rcu_protected, T, flushingThreshold, Update>;
+    friend struct detail::TransactionAccess;
+
 public:
-    explicit rcu_protected(T* ptr) : m_ptr{ptr} {}
+    using value_type    = T;
+    using domain_type   = rcu_domain<TagId>;
+    using event_type    = publish_event<T, Update>;
+    using publish_hook  = folly::Function<void(event_type const&)>;
+    using executor_type = folly::Function<void(folly::Function<void()>)>;
+
+    explicit rcu_protected(T* ptr, Cloner cloner = Cloner())
+        : m_ptr{ptr}
+        , m_ownDomain{std::in_place}
+        , m_domain{&*m_ownDomain}
+        , m_cloner{std::move(cloner)}
+    {}
+
+    // Attach to a domain shared with other RCU objects instead of owning one.
+    // domain must outlive this object.
+    rcu_protected(T* ptr, domain_type& domain, Cloner cloner = Cloner())
+        : m_ptr{ptr}
+        , m_domain{&domain}
+        , m_cloner{std::move(cloner)}
+    {}
+
+    // Adopt initial, e.g. a mapped snapshot, as the first version without
+    // copying it. initial is never modified or pooled: the first update
+    // clones it, and once readers have left it, it is released with its
+    // deleter instead of the cloner.
+    template <typename Deleter>
+    explicit rcu_protected(
+        std::unique_ptr<T const, Deleter> initial, Cloner cloner = Cloner()
+    )
+        // Readers only see it as T const, and the updater only writes its
+        // copies.
+        : rcu_protected(const_cast<T*>(initial.get()), std::move(cloner))
+    {
+        m_adopted        = const_cast<T*>(initial.get());
+        m_releaseAdopted = [initial = std::move(initial)]() mutable
+        { initial.reset(); };
+    }
 
     ~rcu_protected()
     {
-        delete m_ptr.load();
-        for (auto p : m_retireLists[0]) { delete p; }
-        for (auto p : m_retireLists[1]) { delete p; }
-        for (auto p : m_finished) { delete p; }
+        destroy(m_ptr.load());
+        for (auto p : m_retireLists[0]) { destroy(p); }
+        for (auto p : m_retireLists[1]) { destroy(p); }
+        for (auto p : m_finished) { destroy(p); }
+        for (auto p : m_pinned) { destroy(p); }
+        if (m_history)
+        {
+            T* current = m_ptr.load();
+            m_history->for_each([&](T* p) { if (p != current) { destroy(p); } });
+        }
     }
 
     // Returns a protected pointer to T that will automatically unlock when
-    // destroyed. Nested read lock is not handled, user is responsible to
-    // release previous ptr before calling get_ptr again.
+    // destroyed. Read locks may be nested, see rcu_domain::lock.
     auto
     get_ptr() noexcept
     {
         rcu_read_lock();
+#if defined(WBRCU_TRACING)
+        trace_recorder* recorder = this->m_trace;
+        auto deleter = [this, recorder, start = recorder ? recorder->now() : 0](
+                           T const*
+                       )
+        {
+            rcu_read_unlock();
+            if (recorder) { recorder->record(trace_kind::read, start); }
+        };
+#else
         auto deleter = [&](T const*) { rcu_read_unlock(); };
+#endif
         return std::unique_ptr<T const, decltype(deleter)>(
             m_ptr.load(std::memory_order_acquire), deleter
         );
     }
 
-    template <std::invocable<T*> UpdateFunc>
+    // Returns a movable guard of the current object, see read_guard.
+    read_guard<T>
+    get_guard() noexcept
+    {
+        auto& reading = m_domain->lock_local();
+        return read_guard<T>{m_ptr.load(std::memory_order_acquire), reading};
+    }
+
+    // Returns the current object without entering a read-side critical
+    // section. The caller must already be inside one on domain(), and must not
+    // use the pointer after leaving it.
+    T const*
+    get_raw_ptr() const noexcept
+    {
+        return m_ptr.load(std::memory_order_acquire);
+    }
+
+    // Keep the last window published versions, the current one included,
+    // readable with get_version. Older versions are retired as they fall out
+    // of the window. Must be called before the object is shared between
+    // threads.
     void
-    update(UpdateFunc&& updateCallback)
+    keep_history(std::size_t window)
     {
-        if (T* copied = try_register(); copied)
-        {
-            // Registered as the updater.
-            // First perform the update which current thread intends.
-            std::invoke(std::forward<UpdateFunc>(updateCallback), copied);
+        assert(window > 0 && !m_history);
+        m_history.emplace(window);
+        m_history->record(version(), m_ptr.load(std::memory_order_relaxed));
+    }
 
-            // Then perform the updates in m_updateQueue.
-            do_updates(copied);
+    // Returns a protected pointer to the object published as version, like
+    // get_ptr, or a null one if version is not in the history window.
+    auto
+    get_version(uint64_t version) noexcept
+    {
+        rcu_read_lock();
+        auto deleter = [&](T const*) { rcu_read_unlock(); };
+        T const* ptr = m_history ? m_history->find(version) : nullptr;
+        if (!ptr) { rcu_read_unlock(); }
+        return std::unique_ptr<T const, decltype(deleter)>(ptr, deleter);
+    }
+
+    // Returns a pointer to the current object that keeps it from reclamation
+    // without holding a read-side critical section, so that it can be held
+    // for long, e.g. by a background export, without stalling grace periods.
+    // Only the pinned object is parked once retired, other versions are
+    // reclaimed and reused as usual. The pointer may be released on any
+    // thread.
+    auto
+    pin()
+    {
+        rcu_read_lock();
+        T const* ptr = m_ptr.load(std::memory_order_acquire);
+        // Reclaiming ptr waits for our unlock, and then sees the pin.
+        try
+        {
+            pin_object(ptr);
         }
-        else
+        catch (...)
         {
-            // Other updater is working, enqueue the update to perform.
-            m_updateQueue.blockingWrite(std::forward<UpdateFunc>(updateCallback));
+            rcu_read_unlock();
+            throw;
         }
+        rcu_read_unlock();
+        auto deleter = [this](T const* p) { unpin_object(p); };
+        return std::unique_ptr<T const, decltype(deleter)>(ptr, deleter);
+    }
+
+    domain_type&
+    domain() const noexcept
+    {
+        return *m_domain;
+    }
+
+    // Number of objects published so far, the current object being version()
+    // of them.
+    uint64_t
+    version() const noexcept
+    {
+        return m_version.load(std::memory_order_acquire);
+    }
+
+    // Invoke hook on the updater's thread after every publish, e.g. to
+    // maintain an index derived from T incrementally. The hook runs with the
+    // updater role held, so it must not wait to become an updater of this
+    // object. It may subscribe further hooks, which are first invoked on the
+    // next publish.
+    void
+    on_publish(publish_hook hook)
+    {
+        subscribe(std::move(hook), nullptr);
+    }
+
+    // Like on_publish(hook), but hand the invocation to executor so that the
+    // hook does not lengthen the updater's critical path. The objects of the
+    // event are kept from reclamation until the hook has returned. hook may
+    // run concurrently with itself if executor runs tasks in parallel, and
+    // the tasks must not outlive this object.
+    void
+    on_publish(publish_hook hook, executor_type executor)
+    {
+        subscribe(std::move(hook), std::move(executor));
+    }
+
+    // Append the commands of every batch to journal before the batch is
+    // published, see wbrcu::journal. Readers, update_sync and the waiters of
+    // a version only see a batch once it is durable. journal must outlive
+    // this object, and this must be called before the object is shared
+    // between threads. update_together changes the copy with an arbitrary
+    // callable the journal cannot record, it rejects journaled objects.
+    void
+    journal_to(journal<Update>& journal)
+        requires command_set_for<Update, T>
+    {
+        m_journal = &journal;
+        this->m_recordApplied.store(true, std::memory_order_relaxed);
+    }
+
+    // Blocks until version() is greater than lastVersion and returns it.
+    // Publishing only wakes the thread when some are waiting, so a publish
+    // with nobody waiting costs no system call.
+    uint64_t
+    wait_for_change(uint64_t lastVersion)
+    {
+        return wait_until_changed(lastVersion, std::nullopt);
+    }
+
+    // Like wait_for_change(lastVersion), but gives up after timeout, in which
+    // case the returned version is not greater than lastVersion.
+    template <typename Rep, typename Period>
+    uint64_t
+    wait_for_change(
+        uint64_t lastVersion, std::chrono::duration<Rep, Period> timeout
+    )
+    {
+        return wait_until_changed(
+            lastVersion, std::chrono::steady_clock::now() + timeout
+        );
+    }
+
+    // Coroutine support. The awaitables below never block the thread, the
+    // awaiting coroutine is suspended and resumed by the updater right after
+    // it publishes, on the updater's thread and inside its batch. A resumed
+    // coroutine may enqueue further updates of this object, but must not wait
+    // to become its updater, e.g. with update_together. The object must not
+    // be destroyed while coroutines wait on it.
+
+    // co_await update_async(updateCallback) applies updateCallback like
+    // update and resumes once the update is visible to readers. It does not
+    // wait for the update queue to drain when it is full.
+    template <std::invocable<T*> UpdateFunc>
+        requires(!command_set_for<Update, T>)
+    auto
+    update_async(UpdateFunc&& updateCallback)
+    {
+        return update_awaiter<std::decay_t<UpdateFunc>>{
+            *this, std::forward<UpdateFunc>(updateCallback)
+        };
+    }
+
+    // co_await synchronize() resumes once every reader that may be in a
+    // read-side critical section of domain() has left it. If no reader holds
+    // the grace period back, it elapses while awaiting and the coroutine
+    // does not suspend, e.g. on an idle object. Otherwise the coroutine is
+    // resumed by whichever thread later drives the domain: an updater
+    // advancing the epoch, or rcu_domain::poll, which an event loop must call
+    // when there may be no updates. Must not be awaited inside a read-side
+    // critical section.
+    auto
+    synchronize() noexcept
+    {
+        return grace_awaiter{*m_domain};
+    }
+
+    // co_await changed_since(since) resumes once version() is greater than
+    // since and returns the new version.
+    auto
+    changed_since(uint64_t since) noexcept
+    {
+        return change_awaiter{*this, since};
     }
 
 private:
+    template <typename UpdateFunc>
+    class update_awaiter
+    {
+    public:
+        update_awaiter(rcu_protected& protectedObj, UpdateFunc updateCallback)
+            : m_protected{protectedObj}
+            , m_updateCallback{std::move(updateCallback)}
+        {}
+
+        bool
+        await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void
+        await_suspend(std::coroutine_handle<> handle)
+        {
+            m_handle = handle;
+            // The coroutine may be resumed and this awaiter destroyed before
+            // update_nonblocking returns.
+            m_protected.update_nonblocking(
+                [this](T* copied)
+                {
+                    std::invoke(std::move(m_updateCallback), copied);
+                    m_protected.m_batchWaiters.push_back(m_handle);
+                }
+            );
+        }
+
+        void
+        await_resume() const noexcept
+        {}
+
+    private:
+        rcu_protected&          m_protected;
+        UpdateFunc              m_updateCallback;
+        std::coroutine_handle<> m_handle;
+    };
+
+    class grace_awaiter
+    {
+    public:
+        explicit grace_awaiter(domain_type& domain) noexcept : m_domain{domain}
+        {}
+
+        bool
+        await_ready() const noexcept
+        {
+            return false;
+        }
+
+        // Polls for the two epoch advances of a grace period. Whichever of
+        // the callback and await_suspend comes second decides: the callback
+        // resumes the coroutine, await_suspend keeps it from suspending.
+        bool
+        await_suspend(std::coroutine_handle<> handle)
+        {
+            m_domain.call_after_grace_period(
+                [this, handle]
+                {
+                    if (m_arrived.exchange(true, std::memory_order_acq_rel))
+                    {
+                        handle.resume();
+                    }
+                }
+            );
+            m_domain.poll();
+            m_domain.poll();
+            return !m_arrived.exchange(true, std::memory_order_acq_rel);
+        }
+
+        void
+        await_resume() const noexcept
+        {}
+
+    private:
+        domain_type&      m_domain;
+        std::atomic<bool> m_arrived{false};
+    };
+
+    class change_awaiter
+    {
+    public:
+        change_awaiter(rcu_protected& protectedObj, uint64_t since) noexcept
+            : m_protected{protectedObj}, m_since{since}
+        {}
+
+        bool
+        await_ready() const noexcept
+        {
+            return m_protected.version() > m_since;
+        }
+
+        bool
+        await_suspend(std::coroutine_handle<> handle)
+        {
+            return m_protected.wait_for_publish(m_since, handle);
+        }
+
+        uint64_t
+        await_resume() const noexcept
+        {
+            return m_protected.version();
+        }
+
+    private:
+        rcu_protected& m_protected;
+        uint64_t       m_since;
+    };
+
+
     // Pointer to current object that we returns to readers.
     std::atomic<T*> m_ptr;
-    // Current epoch. Previous epoch is !m_epoch.
-    folly::relaxed_atomic<bool> m_epoch{0};
-    // Counters for readers, each thread has a thread_local counter, it avoids
-    // reader contention that std::shared_mutex has.
-    detail::ThreadCachedReaders<Tag> m_counters;
+    // Domain owned by this object, unless it is attached to a shared one.
+    std::optional<domain_type> m_ownDomain;
+    // Domain holding the reader registry and the epoch.
+    domain_type* m_domain;
 
     // Lists of objects that are not accessible by new readers and waiting to be
     // reclaimed.
-    // m_retireLists[m_epoch] is the list of objects that are protected for
-    // current epoch, any readers locking in current epoch will prevent this
-    // list of objects to be reclaimed. Similarly, m_retireLists[!m_epoch] is
-    // the list of objects that are protected for previous epoch.
+    // m_retireLists[e & 1] is the list of objects retired in epoch
+    // m_retireEpochs[e & 1], any readers locking in that epoch will prevent
+    // this list of objects to be reclaimed. Objects retired in epoch e are safe
+    // to reclaim once the domain reaches epoch e + 2.
     std::array<std::vector<T*>, 2> m_retireLists;
+    std::array<uint64_t, 2>        m_retireEpochs{};
     // List of retired objects ready to be reclaimed. We don't reclaim all of
     // them immediately, instead, we use it as the object pool of T to reuse the
     // allocated memory.
     std::vector<T*> m_finished;
+    // Makes the updater's copies of T, see cloner_for.
+    [[no_unique_address]] Cloner m_cloner;
+
+    // Number of publishes, see version.
+    std::atomic<uint64_t> m_version{0};
+    // Coroutines awaiting update_async whose update was applied to the copy
+    // being built, resumed when it is published. Only accessed by the updater.
+    std::vector<std::coroutine_handle<>> m_batchWaiters;
+    // Coroutines awaiting changed_since, with the version they wait past.
+    // m_hasChangeWaiters lets publish skip the lock when nobody waits.
+    std::mutex                                                m_changeMutex;
+    std::vector<std::pair<uint64_t, std::coroutine_handle<>>> m_changeWaiters;
+    std::atomic<bool> m_hasChangeWaiters{false};
+    // Last published versions, see keep_history.
+    std::optional<detail::VersionHistory<T>> m_history;
 
-    // Count of updates to do for updater, every call to update will increment
-    // it. If it is greater than 0, then there is an updater in work, the call
-    // to update will enqueue the update-to-do. This atomic variable effectively
-    // prevents data race on m_retireLists and m_finished.
-    std::atomic<uint64_t> m_updateCnt{0};
-    // Queue of updates to perform.
-    folly::MPMCQueue<folly::Function<void(T*)>> m_updateQueue{
-        500 * hardware_concurrency
+    // Publish hooks, with the executor they are invoked through if any.
+    // m_hasSubscribers lets publish skip the lock when there is none.
+    struct Subscriber
+    {
+        publish_hook  hook;
+        executor_type executor;
     };
+    std::mutex                               m_subscribersMutex;
+    std::vector<std::unique_ptr<Subscriber>> m_subscribers;
+    std::atomic<bool>                        m_hasSubscribers{false};
+    // Subscribers being notified of a publish, copied from m_subscribers.
+    // Only accessed by the updater.
+    std::vector<Subscriber*> m_notifying;
+    // Objects held by pointers returned by pin and by events handed to
+    // executors whose hook has not returned, once per holder. Retired objects
+    // among them are parked in m_pinned instead of being reclaimed, until
+    // they are released. m_pinCnt lets reclaim skip the lock when nothing is
+    // pinned.
+    std::mutex               m_pinsMutex;
+    std::vector<T const*>    m_pins;
+    std::atomic<std::size_t> m_pinCnt{0};
+    std::vector<T*>          m_pinned;
+
+    // Write-ahead journal of the applied commands, see journal_to.
+    journal<Update>* m_journal = nullptr;
+
+    // Initial object adopted from the caller and how to release it, until it
+    // is reclaimed.
+    T*                      m_adopted = nullptr;
+    folly::Function<void()> m_releaseAdopted;
+
+    // Low 32 bits of m_version, the futex word of wait_for_change, and the
+    // number of threads blocked on it.
+    std::atomic<uint32_t> m_versionWord{0};
+    std::atomic<uint32_t> m_versionWaiters{0};
 
     void
     rcu_read_lock() noexcept
     {
-        m_counters.increment(m_epoch);
+        m_domain->lock();
     }
 
     void
     rcu_read_unlock() noexcept
     {
-        m_counters.decrement();
+        m_domain->unlock();
     }
 
     T*
@@ -133,77 +533,242 @@ private:
     {
         T* copied;
         T& curr = *m_ptr.load(std::memory_order_relaxed);
-        if (m_finished.empty()) { copied = new T(curr); }
+        if (m_finished.empty()) { copied = m_cloner.clone(curr); }
         else
         {
-            // Reuse memory from the object pool and perform copy
-            // assignment.
+            // Reuse memory from the object pool and clone into it.
             copied = m_finished.back();
             m_finished.pop_back();
-            *copied = curr;
+            m_cloner.clone_into(*copied, curr);
         }
         return copied;
     }
 
-    // Returns a pointer to the copied object if current thread successfully
-    // register as the updater, otherwise returns nullptr.
-    T*
-    try_register()
+    // Return a copy from get_copy that will not be published to the object
+    // pool.
+    void
+    discard_copy(T* copied) noexcept
     {
-        if (!m_updateCnt.fetch_add(1, std::memory_order_relaxed))
+        try
         {
-            std::atomic_thread_fence(std::memory_order_acquire);
-            return get_copy();
+            m_finished.push_back(copied);
+        }
+        catch (...)
+        {
+            destroy(copied);
         }
-        return nullptr;
     }
 
-    // Perform updates in the update queue, publish updates and push the old
-    // object to the retire list.
+    // Publish the updated copy to readers and push the old object to the
+    // retire list, then resume the coroutines waiting for it.
     void
-    do_updates(T* copied)
+    publish(T* copied)
     {
-        folly::Function<void(T*)> updateToDo;
-        uint64_t                  done = 1;
-        auto updateCnt = m_updateCnt.load(std::memory_order_relaxed);
-        while (true)
+        install(copied);
+
+        // Resumed coroutines only enqueue further updates, m_batchWaiters
+        // does not grow while we iterate.
+        for (auto handle : m_batchWaiters) { handle.resume(); }
+        m_batchWaiters.clear();
+        resume_change_waiters();
+    }
+
+    // Object replaced by a publish, and the one that replaced it as version.
+    struct Installed
+    {
+        T*       previous;
+        T*       current;
+        uint64_t version;
+    };
+
+    void
+    install(T* copied)
+    {
+        finish_install(swap_in(copied));
+    }
+
+    // Make copied the object readers see. This is the part of a publish that
+    // update_together runs under rcu_domain::lock_publish, the rest is done
+    // by finish_install once the lock is released.
+    Installed
+    swap_in(T* copied)
+    {
+        if constexpr (command_set_for<Update, T>)
+        {
+            if (m_journal && !this->m_applied.empty())
+            {
+                m_journal->commit(
+                    this->m_applied,
+                    m_version.load(std::memory_order_relaxed) + 1
+                );
+            }
+        }
+        auto old_ptr = m_ptr.exchange(copied, std::memory_order_release);
+        // Sequentially consistent with the loads of m_hasChangeWaiters and
+        // m_versionWaiters, so that either a new waiter sees the new version
+        // or we see the waiter.
+        uint64_t version = m_version.fetch_add(1, std::memory_order_seq_cst) + 1;
+        return {old_ptr, copied, version};
+    }
+
+    // Wake the waiters of the new version, notify the subscribers and retire
+    // the replaced object, which may run grace-period callbacks.
+    void
+    finish_install(Installed installed)
+    {
+        auto [old_ptr, copied, version] = installed;
+        // With a history window the old object stays readable, the one
+        // falling out of the window is retired instead.
+        T* retired = m_history ? m_history->record(version, copied) : old_ptr;
+        m_versionWord.store(
+            static_cast<uint32_t>(version), std::memory_order_release
+        );
+        if (m_versionWaiters.load(std::memory_order_seq_cst))
+        {
+            detail::futex_wake_all(m_versionWord);
+        }
+        if (m_hasSubscribers.load(std::memory_order_acquire))
+        {
+            notify_subscribers(old_ptr, copied, version);
+        }
+        this->m_applied.clear();
+        if (retired) { retire(retired); }
+    }
+
+    void
+    subscribe(publish_hook hook, executor_type executor)
+    {
+        std::scoped_lock lock{m_subscribersMutex};
+        m_subscribers.push_back(std::make_unique<Subscriber>(
+            Subscriber{std::move(hook), std::move(executor)}
+        ));
+        m_hasSubscribers.store(true, std::memory_order_release);
+        if constexpr (command_set_for<Update, T>)
+        {
+            this->m_recordApplied.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    void
+    notify_subscribers(T const* previous, T const* current, uint64_t version)
+    {
+        // Hooks run without the lock, so that they may subscribe further
+        // hooks. Subscribers are never removed, the pointers stay valid.
+        {
+            std::scoped_lock lock{m_subscribersMutex};
+            m_notifying.clear();
+            for (auto& subscriber : m_subscribers)
+            {
+                m_notifying.push_back(subscriber.get());
+            }
+        }
+
+        event_type event{previous, current, version, this->m_applied};
+        for (auto* subscriber : m_notifying)
+        {
+            if (!subscriber->executor) { subscriber->hook(event); }
+        }
+
+        // Deferred hooks share the batch, which they keep alive, and pin the
+        // two objects of the event until they have returned.
+        std::shared_ptr<std::vector<Update> const> applied;
+        for (auto* subscriber : m_notifying)
         {
-            uint64_t unflushed = 0;
-            do {
-                while (done < updateCnt)
+            if (!subscriber->executor) { continue; }
+            if (!applied && !this->m_applied.empty())
+            {
+                applied = std::make_shared<std::vector<Update> const>(
+                    std::move(this->m_applied)
+                );
+                event.applied = *applied;
+            }
+            pin_object(previous);
+            pin_object(current);
+            subscriber->executor(
+                [this, hook = &subscriber->hook, event, applied]
                 {
-                    m_updateQueue.blockingRead(updateToDo);
-                    updateToDo(copied);
-                    ++done;
-                    if (++unflushed == flushingThreshold) {
-                        break;
-                    }
+                    (*hook)(event);
+                    unpin_object(event.previous);
+                    unpin_object(event.current);
                 }
+            );
+        }
+    }
+
+    uint64_t
+    wait_until_changed(
+        uint64_t                                             lastVersion,
+        std::optional<std::chrono::steady_clock::time_point> deadline
+    )
+    {
+        m_versionWaiters.fetch_add(1, std::memory_order_seq_cst);
+        uint64_t version;
+        while ((version = m_version.load(std::memory_order_seq_cst))
+               <= lastVersion)
+        {
+            // The kernel compares the word with the version we have seen, so
+            // a publish after the load makes the wait return immediately.
+            auto expected = static_cast<uint32_t>(version);
+            if (!deadline) { detail::futex_wait(m_versionWord, expected); }
+            else
+            {
+                auto now = std::chrono::steady_clock::now();
+                if (now >= *deadline) { break; }
+                detail::futex_wait(m_versionWord, expected, *deadline - now);
+            }
+        }
+        m_versionWaiters.fetch_sub(1, std::memory_order_relaxed);
+        return version;
+    }
 
-                if (unflushed == flushingThreshold) {
-                    break;
+    // Registers handle to be resumed once the version is past since. Returns
+    // false if it already is, in which case the coroutine is not suspended.
+    bool
+    wait_for_publish(uint64_t since, std::coroutine_handle<> handle)
+    {
+        std::scoped_lock lock{m_changeMutex};
+        m_hasChangeWaiters.store(true, std::memory_order_seq_cst);
+        if (m_version.load(std::memory_order_seq_cst) > since) { return false; }
+        m_changeWaiters.emplace_back(since, handle);
+        return true;
+    }
+
+    void
+    resume_change_waiters()
+    {
+        if (!m_hasChangeWaiters.load(std::memory_order_seq_cst)) { return; }
+
+        uint64_t                             version = m_version.load();
+        std::vector<std::coroutine_handle<>> ready;
+        {
+            std::scoped_lock lock{m_changeMutex};
+            std::erase_if(
+                m_changeWaiters,
+                [&](auto const& waiter)
+                {
+                    if (waiter.first >= version) { return false; }
+                    ready.push_back(waiter.second);
+                    return true;
                 }
-                updateCnt = m_updateCnt.load(std::memory_order_relaxed);
-            } while (done != updateCnt);
-
-            // Publish updates to readers.
-            auto old_ptr = m_ptr.exchange(copied, std::memory_order_release);
-            retire(old_ptr);
-
-            // Check if there is new updates enqueued after we retire the old
-            // pointer
-            if (done == updateCnt && m_updateCnt.compare_exchange_strong(
-                    updateCnt,
-                    0,
-                    std::memory_order_release,
-                    std::memory_order_relaxed
-                ))
+            );
+            if (m_changeWaiters.empty())
             {
-                return; // Finished updating
+                m_hasChangeWaiters.store(false, std::memory_order_relaxed);
             }
+        }
+        for (auto handle : ready) { handle.resume(); }
+    }
 
-            copied = get_copy();
+    void
+    destroy(T* ptr) noexcept
+    {
+        if (ptr == m_adopted && m_adopted) [[unlikely]]
+        {
+            m_adopted = nullptr;
+            std::exchange(m_releaseAdopted, nullptr)();
+            return;
         }
+        detail::destroy_with(m_cloner, ptr);
     }
 
     void
@@ -211,23 +776,106 @@ private:
     {
         constexpr static uint64_t cleanupThreshold = hardware_concurrency;
 
-        bool curr = m_epoch, prev = !curr;
+        uint64_t epoch = m_domain->epoch();
+        bool     curr = epoch & 1, prev = !curr;
+        if (m_retireEpochs[curr] != epoch)
+        {
+            // The list was filled at least two epochs ago, when other updaters
+            // of the domain advanced the epoch twice since our last retire.
+            reclaim(curr);
+            m_retireEpochs[curr] = epoch;
+        }
         m_retireLists[curr].push_back(ptr);
 
         if (m_retireLists[curr].size() < cleanupThreshold
-            || !m_counters.epochIsClear(prev))
+            || !m_domain->try_advance(epoch))
         {
             return;
         }
 
         // All readers locking previous epoch have finished, it is now safe to
-        // reclaim any object in m_retireLists[prev] and increment current
-        // epoch.
-        std::swap(m_finished, m_retireLists[prev]);
-        for (auto p : m_retireLists[prev]) { delete p; }
-        m_retireLists[prev].clear();
-        m_epoch.store(prev);
+        // reclaim any object in m_retireLists[prev]. The list is emptied and
+        // becomes the one of the new epoch, so that the next retire does not
+        // reclaim it again and give up the pool reclaim has just filled.
+        reclaim(prev);
+        m_retireEpochs[prev] = epoch + 1;
+        // Run the grace-period callbacks of the domain that became ready.
+        m_domain->poll();
+    }
+
+    void
+    pin_object(T const* ptr)
+    {
+        std::scoped_lock lock{m_pinsMutex};
+        m_pins.push_back(ptr);
+        m_pinCnt.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void
+    unpin_object(T const* ptr)
+    {
+        std::scoped_lock lock{m_pinsMutex};
+        auto it = std::find(m_pins.begin(), m_pins.end(), ptr);
+        *it     = m_pins.back();
+        m_pins.pop_back();
+        m_pinCnt.fetch_sub(1, std::memory_order_release);
+    }
+
+    void
+    reclaim(bool index)
+    {
+        auto& retired = m_retireLists[index];
+        if (!m_pinned.empty())
+        {
+            retired.insert(retired.end(), m_pinned.begin(), m_pinned.end());
+            m_pinned.clear();
+        }
+        if (m_pinCnt.load(std::memory_order_acquire))
+        {
+            // Park the objects that pins and events handed to executors may
+            // still refer to.
+            std::scoped_lock lock{m_pinsMutex};
+            std::erase_if(
+                retired,
+                [this](T* p)
+                {
+                    if (std::find(m_pins.begin(), m_pins.end(), p)
+                        == m_pins.end())
+                    {
+                        return false;
+                    }
+                    m_pinned.push_back(p);
+                    return true;
+                }
+            );
+        }
+        if (m_adopted) [[unlikely]]
+        {
+            // The adopted object must not be reused from the pool.
+            if (auto it = std::find(retired.begin(), retired.end(), m_adopted);
+                it != retired.end())
+            {
+                retired.erase(it);
+                destroy(m_adopted);
+            }
+        }
+        std::swap(m_finished, m_retireLists[index]);
+        for (auto p : m_retireLists[index]) { destroy(p); }
+        m_retireLists[index].clear();
     }
 };
 
+// rcu_protected whose updates are the commands T declares as T::command, a
+// std::variant of command structs that T applies with apply(command). Commands
+// are stored by value in the update queue, without allocation or type
+// erasure, and dispatched with std::visit in the batch loop.
+template <
+    typename T,
+    uint64_t      TagId             = 0,
+    uint64_t      flushingThreshold = 20,
+    cloner_for<T> Cloner            = default_cloner<T>>
+    requires command_set_for<typename T::command, T>
+using command_protected =
+    rcu_protected<T, TagId, flushingThreshold, Cloner, typename T::command>;
+
 } // namespace wbrcu
@@ -0,0 +1,261 @@
+#pragma once
+
+#include "rcu_protected.hpp"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace wbrcu
+{
+
+namespace detail
+{
+
+// Gives update_together access to the updater-side members of
+// rcu_protected.
+struct TransactionAccess
+{
+    template <typename Protected>
+    static auto*
+    register_exclusive(Protected& p)
+    {
+        return p.register_exclusive();
+    }
+
+    template <typename Protected, typename T>
+    static auto
+    swap_in(Protected& p, T* copied)
+    {
+        return p.swap_in(copied);
+    }
+
+    template <typename Protected, typename Installed>
+    static void
+    finish_install(Protected& p, Installed installed)
+    {
+        p.finish_install(installed);
+    }
+
+    template <typename Protected>
+    static bool
+    journaled(Protected const& p) noexcept
+    {
+        return p.m_journal != nullptr;
+    }
+
+    template <typename Protected, typename T>
+    static void
+    discard(Protected& p, T* copied) noexcept
+    {
+        p.discard_copy(copied);
+    }
+
+    template <typename Protected>
+    static void
+    finish_exclusive(Protected& p)
+    {
+        p.finish_exclusive();
+    }
+
+    template <typename Protected>
+    static void
+    resume_change_waiters(Protected& p)
+    {
+        p.resume_change_waiters();
+    }
+};
+
+// Runs onUnwind when destroyed, unless dismiss was called before.
+template <typename Func>
+class UnwindGuard
+{
+public:
+    explicit UnwindGuard(Func onUnwind) : m_onUnwind{std::move(onUnwind)} {}
+
+    UnwindGuard(UnwindGuard const&)            = delete;
+    UnwindGuard& operator=(UnwindGuard const&) = delete;
+
+    ~UnwindGuard()
+    {
+        if (m_active) { m_onUnwind(); }
+    }
+
+    void
+    dismiss() noexcept
+    {
+        m_active = false;
+    }
+
+private:
+    Func m_onUnwind;
+    bool m_active = true;
+};
+
+template <typename First, typename... Rest>
+First&
+first_of(First& first, Rest&...) noexcept
+{
+    return first;
+}
+
+} // namespace detail
+
+// Apply updateCallback to copies of several rcu_protected instances of one
+// domain and publish all of them as a single change: a multi_read_guard over
+// the same instances sees either every new version or none of them.
+//
+// The caller becomes the exclusive updater of each instance, waiting for the
+// current updater to finish if there is one, in address order so that
+// concurrent transactions over overlapping instances cannot deadlock. The
+// current updater hands its role over once it reaches the transaction in the
+// update queue, so a steady stream of updates cannot starve it. Updates
+// enqueued on an instance meanwhile are applied after the transaction. Each
+// instance may appear only once. If updateCallback throws, nothing is
+// published and every instance is released. Throws std::logic_error if an
+// instance keeps a journal, see rcu_protected::journal_to.
+template <typename UpdateFunc, typename... Protected>
+    requires(sizeof...(Protected) > 0)
+         && std::invocable<UpdateFunc, typename Protected::value_type*...>
+void
+update_together(UpdateFunc&& updateCallback, Protected&... protectedObjs)
+{
+    using Access = detail::TransactionAccess;
+
+    auto& domain = detail::first_of(protectedObjs...).domain();
+    assert(((&protectedObjs.domain() == &domain) && ...));
+    if ((Access::journaled(protectedObjs) || ...))
+    {
+        throw std::logic_error(
+            "wbrcu: update_together cannot journal its changes"
+        );
+    }
+
+    // An instance is registered once its copy is set. If anything throws
+    // before the publish, the copies go back to their instance's pool and
+    // the updater role is given up, performing the updates enqueued behind
+    // the transaction.
+    std::tuple<typename Protected::value_type*...> copies;
+    detail::UnwindGuard release{
+        [&]
+        {
+            [&]<std::size_t... Is>(std::index_sequence<Is...>)
+            {
+                auto releaseOne = [](auto& protectedObj, auto* copied)
+                {
+                    if (!copied) { return; }
+                    Access::discard(protectedObj, copied);
+                    Access::finish_exclusive(protectedObj);
+                };
+                (releaseOne(protectedObjs, std::get<Is>(copies)), ...);
+            }(std::index_sequence_for<Protected...>{});
+        }
+    };
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        using Register = std::pair<void const*, std::function<void()>>;
+        std::array<Register, sizeof...(Is)> registers{
+            Register{
+                &protectedObjs,
+                [&copies, &protectedObjs]
+                {
+                    std::get<Is>(copies) =
+                        Access::register_exclusive(protectedObjs);
+                }
+            }...
+        };
+        std::sort(
+            registers.begin(),
+            registers.end(),
+            [](Register const& lhs, Register const& rhs)
+            { return std::less<void const*>{}(lhs.first, rhs.first); }
+        );
+        for (auto& [ptr, registerFunc] : registers) { registerFunc(); }
+    }(std::index_sequence_for<Protected...>{});
+
+    std::apply(std::forward<UpdateFunc>(updateCallback), copies);
+    release.dismiss();
+
+    // Only the pointers are swapped while multi_read_guard readers wait on
+    // the publish sequence. Hooks, retirement and grace-period callbacks run
+    // after, so that they may read or update the domain themselves.
+    [&]<std::size_t... Is>(std::index_sequence<Is...>)
+    {
+        domain.lock_publish();
+        std::tuple installed{
+            Access::swap_in(protectedObjs, std::get<Is>(copies))...
+        };
+        domain.unlock_publish();
+        (Access::finish_install(protectedObjs, std::get<Is>(installed)), ...);
+    }(std::index_sequence_for<Protected...>{});
+
+    (Access::finish_exclusive(protectedObjs), ...);
+    // Coroutines waiting for a change are resumed once every instance is
+    // released, so that they may start a transaction of their own.
+    (Access::resume_change_waiters(protectedObjs), ...);
+}
+
+// Read guard over several rcu_protected instances of one domain. It enters a
+// single read-side critical section and loads the current objects so that
+// changes published by update_together are seen entirely or not at all.
+// Supports structured bindings:
+//
+//     auto [routes, index] = multi_read_guard{routesRcu, indexRcu};
+template <typename... Protected>
+    requires(sizeof...(Protected) > 0)
+class multi_read_guard
+{
+    using domain_type = typename std::tuple_element_t<
+        0,
+        std::tuple<Protected...>>::domain_type;
+
+public:
+    explicit multi_read_guard(Protected&... protectedObjs)
+        : m_domain{&detail::first_of(protectedObjs...).domain()}
+    {
+        assert(((&protectedObjs.domain() == m_domain) && ...));
+        m_domain->lock();
+        uint64_t seq;
+        do {
+            seq    = m_domain->publish_seq();
+            m_ptrs = {protectedObjs.get_raw_ptr()...};
+        } while (m_domain->publish_retry(seq));
+    }
+
+    multi_read_guard(multi_read_guard const&)            = delete;
+    multi_read_guard& operator=(multi_read_guard const&) = delete;
+
+    ~multi_read_guard() { m_domain->unlock(); }
+
+    template <std::size_t I>
+    auto
+    get() const noexcept
+    {
+        return std::get<I>(m_ptrs);
+    }
+
+private:
+    domain_type*                                          m_domain;
+    std::tuple<typename Protected::value_type const*...> m_ptrs;
+};
+
+} // namespace wbrcu
+
+template <typename... Protected>
+struct std::tuple_size<wbrcu::multi_read_guard<Protected...>>
+    : std::integral_constant<std::size_t, sizeof...(Protected)>
+{
+};
+
+template <std::size_t I, typename... Protected>
+struct std::tuple_element<I, wbrcu::multi_read_guard<Protected...>>
+{
+    using type = typename std::tuple_element_t<I, std::tuple<Protected...>>::
+        value_type const*;
+};
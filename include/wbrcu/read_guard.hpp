@@ -0,0 +1,87 @@
+#pragma once
+
+#include "detail/ThreadCachedReaders.hpp"
+#include <utility>
+
+namespace wbrcu
+{
+
+// Movable owner of a read-side critical section and the object loaded in it,
+// returned by rcu_protected::get_guard.
+//
+// Unlike get_ptr, the guard keeps the calling thread's reader slot instead of
+// a reference to the rcu_protected, so it can be returned from functions and
+// stored in longer-lived frames, and leaving the critical section needs no
+// thread-local lookup. Guards nest like any read lock. The section can be
+// left early with release, and must be left on the thread that entered it.
+template <typename T>
+class read_guard
+{
+public:
+    read_guard() = default;
+
+    read_guard(T const* ptr, detail::EpochReading& reading) noexcept
+        : m_ptr{ptr}, m_reading{&reading}
+    {}
+
+    read_guard(read_guard&& other) noexcept
+        : m_ptr{std::exchange(other.m_ptr, nullptr)}
+        , m_reading{std::exchange(other.m_reading, nullptr)}
+    {}
+
+    read_guard&
+    operator=(read_guard&& other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            m_ptr     = std::exchange(other.m_ptr, nullptr);
+            m_reading = std::exchange(other.m_reading, nullptr);
+        }
+        return *this;
+    }
+
+    ~read_guard() { release(); }
+
+    // Leave the critical section. The object must not be accessed afterwards.
+    void
+    release() noexcept
+    {
+        if (m_reading)
+        {
+            detail::reader_unlock(*m_reading);
+            m_ptr     = nullptr;
+            m_reading = nullptr;
+        }
+    }
+
+    T const*
+    get() const noexcept
+    {
+        return m_ptr;
+    }
+
+    T const&
+    operator*() const noexcept
+    {
+        return *m_ptr;
+    }
+
+    T const*
+    operator->() const noexcept
+    {
+        return m_ptr;
+    }
+
+    explicit
+    operator bool() const noexcept
+    {
+        return m_reading != nullptr;
+    }
+
+private:
+    T const*              m_ptr     = nullptr;
+    detail::EpochReading* m_reading = nullptr;
+};
+
+} // namespace wbrcu
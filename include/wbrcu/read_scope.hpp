@@ -0,0 +1,60 @@
+#pragma once
+
+#include "rcu_domain.hpp"
+#include <cassert>
+#include <tuple>
+
+namespace wbrcu
+{
+
+// Read-side critical section on a domain, entered once for any number of
+// reads of the RCU objects attached to it.
+//
+// get returns the raw pointer to the current object, which costs a single
+// acquire load, and stays valid until the scope ends.
+template <uint64_t TagId = 0>
+class read_scope
+{
+public:
+    using domain_type = rcu_domain<TagId>;
+
+    explicit read_scope(domain_type& domain) noexcept : m_domain{domain}
+    {
+        m_domain.lock();
+    }
+
+    read_scope(read_scope const&)            = delete;
+    read_scope& operator=(read_scope const&) = delete;
+
+    ~read_scope() { m_domain.unlock(); }
+
+    template <typename Protected>
+    auto
+    get(Protected const& protectedObj) const noexcept
+    {
+        assert(&protectedObj.domain() == &m_domain);
+        return protectedObj.get_raw_ptr();
+    }
+
+    // Returns a tuple with the current objects of every argument, loaded so
+    // that a change published by update_together is seen entirely or not at
+    // all.
+    template <typename... Protected>
+        requires(sizeof...(Protected) > 1)
+    auto
+    get(Protected const&... protectedObjs) const noexcept
+    {
+        std::tuple<decltype(protectedObjs.get_raw_ptr())...> ptrs;
+        uint64_t                                            seq;
+        do {
+            seq  = m_domain.publish_seq();
+            ptrs = {get(protectedObjs)...};
+        } while (m_domain.publish_retry(seq));
+        return ptrs;
+    }
+
+private:
+    domain_type& m_domain;
+};
+
+} // namespace wbrcu
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "detail/UpdateBatcher.hpp"
+#include "rcu_protected.hpp"
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace wbrcu
+{
+
+// Largest object that seqlock_protected accepts. Readers copy the whole object
+// out on every read, so it has to stay within a couple of cache lines for that
+// to be cheaper than the pointer indirection of rcu_protected.
+inline constexpr std::size_t seqlock_max_size = 64;
+
+template <typename T>
+concept seqlock_eligible =
+    std::is_trivially_copyable_v<T> && sizeof(T) <= seqlock_max_size;
+
+// Sequence-lock flavor of rcu_protected for small trivially-copyable T.
+//
+// Readers copy T out directly and retry if the updater published while they
+// were copying, so reading allocates nothing and writes no shared state. The
+// update side is the same batching front end as rcu_protected, except that the
+// updater modifies a private scratch object that is copied into the published
+// storage at flush, so there is no allocation, retire list or object pool.
+template <seqlock_eligible T, uint64_t flushingThreshold = 20>
+class seqlock_protected
+    : public detail::UpdateBatcher<
+          seqlock_protected<T, flushingThreshold>,
+          T,
+          flushingThreshold>
+{
+    friend class detail::UpdateBatcher<seqlock_protected, T, flushingThreshold>;
+
+public:
+    // A copy of T taken by get_ptr, dereferenceable like the pointer returned
+    // by rcu_protected::get_ptr.
+    class snapshot
+    {
+    public:
+        explicit snapshot(T const& value) noexcept : m_value{value} {}
+
+        T const&
+        operator*() const noexcept
+        {
+            return m_value;
+        }
+
+        T const*
+        operator->() const noexcept
+        {
+            return &m_value;
+        }
+
+    private:
+        T m_value;
+    };
+
+    // Takes ownership of ptr to mirror the rcu_protected constructor.
+    explicit seqlock_protected(T* ptr) : m_scratch{*ptr}
+    {
+        delete ptr;
+        store(m_scratch);
+    }
+
+    // Returns a copy of the latest published T.
+    snapshot
+    get_ptr() const noexcept
+    {
+        return snapshot{load()};
+    }
+
+    T
+    load() const noexcept
+    {
+        std::array<uint64_t, words> buffer;
+        uint64_t                    seq;
+        do {
+            seq = m_seq.load(std::memory_order_acquire);
+            while (seq & 1)
+            {
+                // The updater is storing, wait for it to finish.
+                seq = m_seq.load(std::memory_order_acquire);
+            }
+            for (std::size_t i = 0; i < words; ++i)
+            {
+                buffer[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (seq != m_seq.load(std::memory_order_relaxed));
+
+        std::array<std::byte, sizeof(T)> bytes;
+        std::memcpy(bytes.data(), buffer.data(), sizeof(T));
+        return std::bit_cast<T>(bytes);
+    }
+
+private:
+    static constexpr std::size_t words =
+        (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Sequence number of the published value, odd while the updater is
+    // storing.
+    alignas(64) std::atomic<uint64_t> m_seq{0};
+    // Published value of T, stored word by word so that readers racing with
+    // the updater never perform a non-atomic read.
+    std::array<std::atomic<uint64_t>, words> m_words{};
+
+    // Updater-owned copy of T. It always equals the published value outside
+    // of a batch, so the updater never needs to copy it before updating.
+    alignas(64) T m_scratch;
+
+    T*
+    get_copy() noexcept
+    {
+        return &m_scratch;
+    }
+
+    void
+    publish(T* copied) noexcept
+    {
+        store(*copied);
+    }
+
+    void
+    store(T const& value) noexcept
+    {
+        std::array<uint64_t, words> buffer{};
+        std::memcpy(buffer.data(), &value, sizeof(T));
+
+        auto seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < words; ++i)
+        {
+            m_words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+};
+
+namespace detail
+{
+
+template <typename T, uint64_t TagId, uint64_t flushingThreshold>
+struct auto_protected_impl
+{
+    using type = rcu_protected<T, TagId, flushingThreshold>;
+};
+
+template <seqlock_eligible T, uint64_t TagId, uint64_t flushingThreshold>
+struct auto_protected_impl<T, TagId, flushingThreshold>
+{
+    using type = seqlock_protected<T, flushingThreshold>;
+};
+
+} // namespace detail
+
+// seqlock_protected for types satisfying seqlock_eligible, rcu_protected for
+// everything else.
+template <typename T, uint64_t TagId = 0, uint64_t flushingThreshold = 20>
+using auto_protected =
+    typename detail::auto_protected_impl<T, TagId, flushingThreshold>::type;
+
+} // namespace wbrcu
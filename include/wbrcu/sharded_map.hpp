@@ -0,0 +1,150 @@
+#pragma once
+
+#include "rcu_domain.hpp"
+#include "rcu_map.hpp"
+#include "rcu_protected.hpp"
+#include <array>
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace wbrcu
+{
+
+namespace detail
+{
+
+// Hash of the keys of one shard without the remainder that selected the
+// shard, which all of them share, so that the first level of the shard's
+// trie still fans out.
+template <typename Hash, std::size_t Shards>
+struct ShardHash
+{
+    [[no_unique_address]] Hash hash;
+
+    template <typename K>
+    std::size_t
+    operator()(K const& key) const
+    {
+        return hash(key) / Shards;
+    }
+};
+
+} // namespace detail
+
+// Concurrent hash map that hashes keys to Shards independent rcu_protected
+// maps.
+//
+// Every shard has its own updater and update queue, so writers to keys in
+// different shards do not serialize on each other. All shards are attached to
+// one rcu_domain, so a lookup enters a single read-side critical section and
+// loads exactly one shard pointer, and iteration sees every shard under the
+// same critical section.
+//
+// Each shard is a hamt, so a batch on a shard path-copies the nodes it
+// touches instead of copying the whole shard.
+template <
+    typename K,
+    typename V,
+    std::size_t Shards            = 16,
+    typename Hash                 = std::hash<K>,
+    typename KeyEqual             = std::equal_to<K>,
+    uint64_t    TagId             = 0,
+    uint64_t    flushingThreshold = 20>
+class sharded_map
+{
+public:
+    using map_type =
+        hamt<K, V, detail::ShardHash<Hash, Shards>, KeyEqual>;
+    using shard_type = rcu_protected<map_type, TagId, flushingThreshold>;
+
+    static_assert(Shards > 0);
+
+    sharded_map() : sharded_map(std::make_index_sequence<Shards>{}) {}
+
+    std::optional<V>
+    find(K const& key)
+    {
+        std::scoped_lock guard{m_domain};
+        if (auto const* value = shard_of(key).get_raw_ptr()->find(key))
+        {
+            return *value;
+        }
+        return std::nullopt;
+    }
+
+    bool
+    contains(K const& key)
+    {
+        std::scoped_lock guard{m_domain};
+        return shard_of(key).get_raw_ptr()->contains(key);
+    }
+
+    // Apply updateCallback to the shard holding key. It may only modify
+    // entries whose keys hash to that shard.
+    template <std::invocable<map_type*> UpdateFunc>
+    void
+    update(K const& key, UpdateFunc&& updateCallback)
+    {
+        shard_of(key).update(std::forward<UpdateFunc>(updateCallback));
+    }
+
+    void
+    insert_or_assign(K key, V value)
+    {
+        auto& shard = shard_of(key);
+        shard.update(
+            [key = std::move(key), value = std::move(value)](map_type* map
+            ) mutable { map->insert_or_assign(std::move(key), std::move(value)); }
+        );
+    }
+
+    void
+    erase(K key)
+    {
+        auto& shard = shard_of(key);
+        shard.update([key = std::move(key)](map_type* map) { map->erase(key); });
+    }
+
+    // Calls f(key, value) for every entry of every shard within a single
+    // read-side critical section.
+    template <std::invocable<K const&, V const&> F>
+    void
+    for_each(F&& f)
+    {
+        std::scoped_lock guard{m_domain};
+        for (auto& shard : m_shards) { shard.get_raw_ptr()->for_each(f); }
+    }
+
+    std::size_t
+    size()
+    {
+        std::scoped_lock guard{m_domain};
+        std::size_t      total = 0;
+        for (auto& shard : m_shards) { total += shard.get_raw_ptr()->size(); }
+        return total;
+    }
+
+private:
+    // Shared reader registry of all shards. Declared before m_shards so that
+    // it outlives them.
+    rcu_domain<TagId>              m_domain;
+    std::array<shard_type, Shards> m_shards;
+    [[no_unique_address]] Hash     m_hash;
+
+    template <std::size_t... Is>
+    explicit sharded_map(std::index_sequence<Is...>)
+        : m_shards{{((void)Is, shard_type{new map_type{}, m_domain})...}}
+    {}
+
+    shard_type&
+    shard_of(K const& key)
+    {
+        return m_shards[m_hash(key) % Shards];
+    }
+};
+
+} // namespace wbrcu
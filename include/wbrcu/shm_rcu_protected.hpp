@@ -0,0 +1,524 @@
+#pragma once
+
+#include "detail/Errno.hpp"
+#include "detail/StreamingCopy.hpp"
+#include "detail/UpdateBatcher.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <memory>
+#include <new>
+#include <signal.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+namespace detail
+{
+
+// Reader registration of one process in a shared segment. pid is 0 while the
+// slot is free and -1 while it is being taken back from a dead process;
+// counts[e & 1] is the number of the process' read-side critical sections
+// entered in an epoch of parity e & 1.
+struct alignas(64) ShmReaderSlot
+{
+    std::atomic<int32_t>                 pid{0};
+    std::array<std::atomic<uint32_t>, 2> counts{};
+};
+
+// Sizes of a segment, written by the writer before the segment is opened.
+struct ShmLayout
+{
+    uint64_t magic;
+    uint64_t valueSize;
+    uint64_t controlSize;
+    uint64_t blockSize;
+    uint64_t blockCount;
+    uint64_t readerSlots;
+};
+
+// First pages of a segment, mapped read-write by every process. The reader
+// slots follow at slotsOffset.
+struct ShmControl
+{
+    ShmLayout layout;
+
+    // Block index of the current version.
+    std::atomic<uint64_t> current;
+    std::atomic<uint64_t> epoch;
+    std::atomic<uint64_t> version;
+};
+
+inline constexpr std::size_t slotsOffset =
+    (sizeof(ShmControl) + alignof(ShmReaderSlot) - 1) / alignof(ShmReaderSlot)
+    * alignof(ShmReaderSlot);
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+static_assert(std::atomic<int32_t>::is_always_lock_free);
+
+inline constexpr uint64_t shmMagic = 0x77627263752d7368; // "wbrcu-sh"
+
+inline std::size_t
+round_up(std::size_t n, std::size_t alignment) noexcept
+{
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+inline bool
+process_alive(int32_t pid) noexcept
+{
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+// Frees the slot if its owner has died, returns whether the slot is free.
+inline bool
+reap_if_dead(ShmReaderSlot& slot) noexcept
+{
+    int32_t pid = slot.pid.load(std::memory_order_acquire);
+    if (pid == 0) { return true; }
+    if (pid < 0 || process_alive(pid)) { return false; }
+    if (!slot.pid.compare_exchange_strong(pid, -1)) { return false; }
+    slot.counts[0].store(0, std::memory_order_relaxed);
+    slot.counts[1].store(0, std::memory_order_relaxed);
+    slot.pid.store(0, std::memory_order_release);
+    return true;
+}
+
+// Mapping of a segment of versions of T in POSIX shared memory: the control
+// pages, followed by blockCount blocks of one T each. Versions are addressed
+// by block index, never by pointer, since every process maps the segment at
+// its own address.
+template <typename T>
+class ShmSegment
+{
+public:
+    // Create the segment name, replacing any existing one, with initial in
+    // block 0.
+    ShmSegment(
+        std::string name,
+        T const&    initial,
+        std::size_t blockCount,
+        std::size_t readerSlots
+    )
+        : m_name{std::move(name)}
+    {
+        std::size_t pageSize    = sysconf(_SC_PAGESIZE);
+        std::size_t controlSize = round_up(
+            slotsOffset + readerSlots * sizeof(ShmReaderSlot), pageSize
+        );
+        std::size_t blockSize =
+            round_up(sizeof(T), std::max<std::size_t>(alignof(T), 64));
+        std::size_t totalSize =
+            controlSize + round_up(blockSize * blockCount, pageSize);
+
+        shm_unlink(m_name.c_str());
+        int fd = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) { throw_errno("shm_open"); }
+        if (ftruncate(fd, static_cast<off_t>(totalSize)) != 0)
+        {
+            close(fd);
+            shm_unlink(m_name.c_str());
+            throw_errno("ftruncate");
+        }
+        try
+        {
+            map(fd, controlSize, totalSize - controlSize, PROT_READ | PROT_WRITE);
+        }
+        catch (...)
+        {
+            shm_unlink(m_name.c_str());
+            throw;
+        }
+
+        auto& ctrl = control();
+        ::new (&ctrl) ShmControl{
+            {0, sizeof(T), controlSize, blockSize, blockCount, readerSlots},
+            {0},
+            {0},
+            {0}
+        };
+        for (std::size_t i = 0; i < readerSlots; ++i)
+        {
+            ::new (&slots()[i]) ShmReaderSlot;
+        }
+        copy_assign(*block(0), initial);
+        std::atomic_ref<uint64_t>{ctrl.layout.magic}.store(
+            shmMagic, std::memory_order_release
+        );
+    }
+
+    // Open the existing segment name, with the versions mapped read-only.
+    explicit ShmSegment(std::string name) : m_name{std::move(name)}
+    {
+        int fd = shm_open(m_name.c_str(), O_RDWR, 0);
+        if (fd < 0) { throw_errno("shm_open"); }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < off_t{sizeof(ShmControl)})
+        {
+            close(fd);
+            throw std::runtime_error(
+                "wbrcu: shared segment is not initialized"
+            );
+        }
+        ShmLayout header;
+        if (pread(fd, &header, sizeof(header), 0) != sizeof(header)
+            || header.magic != shmMagic || header.valueSize != sizeof(T))
+        {
+            close(fd);
+            throw std::runtime_error("wbrcu: shared segment layout mismatch");
+        }
+        map(fd,
+            header.controlSize,
+            static_cast<std::size_t>(st.st_size) - header.controlSize,
+            PROT_READ);
+    }
+
+    ShmSegment(ShmSegment const&)            = delete;
+    ShmSegment& operator=(ShmSegment const&) = delete;
+
+    ~ShmSegment()
+    {
+        munmap(m_data, m_dataSize);
+        munmap(m_control, m_controlSize);
+    }
+
+    std::string const&
+    name() const noexcept
+    {
+        return m_name;
+    }
+
+    ShmControl&
+    control() const noexcept
+    {
+        return *static_cast<ShmControl*>(m_control);
+    }
+
+    ShmReaderSlot*
+    slots() const noexcept
+    {
+        return reinterpret_cast<ShmReaderSlot*>(
+            static_cast<std::byte*>(m_control) + slotsOffset
+        );
+    }
+
+    T*
+    block(uint64_t index) const noexcept
+    {
+        return reinterpret_cast<T*>(
+            static_cast<std::byte*>(m_data) + index * control().layout.blockSize
+        );
+    }
+
+    uint64_t
+    index_of(T const* ptr) const noexcept
+    {
+        return (reinterpret_cast<std::byte const*>(ptr)
+                - static_cast<std::byte const*>(m_data))
+             / control().layout.blockSize;
+    }
+
+    // Take a reader slot for the calling process, reclaiming the slots of
+    // dead processes if none is free.
+    ShmReaderSlot&
+    claim_slot()
+    {
+        int32_t pid = getpid();
+        for (int pass = 0; pass < 2; ++pass)
+        {
+            for (std::size_t i = 0; i < control().layout.readerSlots; ++i)
+            {
+                auto&   slot     = slots()[i];
+                int32_t expected = 0;
+                if (pass == 1) { reap_if_dead(slot); }
+                if (slot.pid.compare_exchange_strong(expected, pid))
+                {
+                    return slot;
+                }
+            }
+        }
+        throw std::runtime_error(
+            "wbrcu: no free reader slot in shared segment"
+        );
+    }
+
+    // Enter a read-side critical section on slot and load the current
+    // version. Sequentially consistent with the writer's publish and epoch
+    // checks, which cannot use the process-local fences rcu_domain relies on.
+    T const*
+    lock(ShmReaderSlot& slot, uint32_t& parity) const noexcept
+    {
+        parity = control().epoch.load(std::memory_order_seq_cst) & 1;
+        slot.counts[parity].fetch_add(1, std::memory_order_seq_cst);
+        return block(control().current.load(std::memory_order_seq_cst));
+    }
+
+    static void
+    unlock(ShmReaderSlot& slot, uint32_t parity) noexcept
+    {
+        slot.counts[parity].fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    std::string m_name;
+    void*       m_control     = nullptr;
+    std::size_t m_controlSize = 0;
+    void*       m_data        = nullptr;
+    std::size_t m_dataSize    = 0;
+
+    void
+    map(int fd, std::size_t controlSize, std::size_t dataSize, int dataProt)
+    {
+        m_control = mmap(
+            nullptr, controlSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0
+        );
+        if (m_control == MAP_FAILED)
+        {
+            close(fd);
+            throw_errno("mmap");
+        }
+        m_controlSize = controlSize;
+        m_data        = mmap(
+            nullptr,
+            dataSize,
+            dataProt,
+            MAP_SHARED,
+            fd,
+            static_cast<off_t>(controlSize)
+        );
+        close(fd);
+        if (m_data == MAP_FAILED)
+        {
+            munmap(m_control, controlSize);
+            throw_errno("mmap");
+        }
+        m_dataSize = dataSize;
+    }
+};
+
+} // namespace detail
+
+// rcu_protected whose versions live in POSIX shared memory, so that reader
+// processes opening the segment with shm_rcu_reader read the writer's
+// versions in place instead of each building their own copy.
+//
+// T must be trivially copyable and must not hold pointers, since every
+// process maps the segment at its own address; link within T by offsets or
+// indices. The segment holds blockCount versions, the updater waits for
+// readers to leave older versions when all blocks are in use. A thread must
+// therefore not update while it holds a pointer from get_ptr: once every
+// block is in use, the update waits for that pointer's release and spins
+// forever.
+//
+// Reader processes register in the segment's reader slots and count their
+// critical sections per epoch parity there. A process that dies inside a
+// critical section would hold back reclamation forever, so the updater takes
+// back the slots of processes that no longer exist, which it detects with
+// kill(pid, 0). A reused pid keeps the slot until that process exits.
+//
+// The object owns the segment, it unlinks it when destroyed.
+template <typename T, uint64_t flushingThreshold = 20>
+    requires std::is_trivially_copyable_v<T>
+class shm_rcu_protected
+    : public detail::UpdateBatcher<
+          shm_rcu_protected<T, flushingThreshold>,
+          T,
+          flushingThreshold>
+{
+    friend class detail::UpdateBatcher<shm_rcu_protected, T, flushingThreshold>;
+
+public:
+    using value_type = T;
+
+    shm_rcu_protected(
+        std::string name,
+        T const&    initial,
+        std::size_t blockCount  = 4,
+        std::size_t readerSlots = 64
+    )
+        : m_segment{
+              std::move(name),
+              initial,
+              std::max<std::size_t>(blockCount, 3),
+              readerSlots
+          }
+        , m_slot{&m_segment.claim_slot()}
+    {
+        for (uint64_t i = 1; i < m_segment.control().layout.blockCount; ++i)
+        {
+            m_free.push_back(i);
+        }
+    }
+
+    ~shm_rcu_protected()
+    {
+        m_slot->pid.store(0, std::memory_order_release);
+        shm_unlink(m_segment.name().c_str());
+    }
+
+    // Returns a protected pointer to the current version, see
+    // rcu_protected::get_ptr.
+    auto
+    get_ptr() noexcept
+    {
+        uint32_t parity;
+        T const* ptr     = m_segment.lock(*m_slot, parity);
+        auto     deleter = [slot = m_slot, parity](T const*)
+        { detail::ShmSegment<T>::unlock(*slot, parity); };
+        return std::unique_ptr<T const, decltype(deleter)>(ptr, deleter);
+    }
+
+    uint64_t
+    version() const noexcept
+    {
+        return m_segment.control().version.load(std::memory_order_acquire);
+    }
+
+private:
+    detail::ShmSegment<T>   m_segment;
+    detail::ShmReaderSlot*  m_slot;
+    // Blocks holding no version readers can reach.
+    std::vector<uint64_t> m_free;
+    // Blocks retired in epoch m_retireEpochs[e & 1], see rcu_protected.
+    std::array<std::vector<uint64_t>, 2> m_retireLists;
+    std::array<uint64_t, 2>              m_retireEpochs{};
+
+    T*
+    get_copy()
+    {
+        // Versions can be large and blocks few, wait for readers to free one
+        // rather than growing the segment.
+        while (m_free.empty())
+        {
+            if (try_advance()) { collect(); }
+            else { std::this_thread::yield(); }
+        }
+        T* copied = m_segment.block(m_free.back());
+        m_free.pop_back();
+        auto& ctrl = m_segment.control();
+        detail::copy_assign(
+            *copied,
+            *m_segment.block(ctrl.current.load(std::memory_order_relaxed))
+        );
+        return copied;
+    }
+
+    void
+    publish(T* copied)
+    {
+        auto& ctrl = m_segment.control();
+        uint64_t old = ctrl.current.exchange(
+            m_segment.index_of(copied), std::memory_order_seq_cst
+        );
+        ctrl.version.fetch_add(1, std::memory_order_release);
+        retire(old);
+    }
+
+    void
+    retire(uint64_t index)
+    {
+        uint64_t epoch =
+            m_segment.control().epoch.load(std::memory_order_relaxed);
+        bool     curr  = epoch & 1;
+        if (m_retireEpochs[curr] != epoch)
+        {
+            collect();
+            m_retireEpochs[curr] = epoch;
+        }
+        m_retireLists[curr].push_back(index);
+        if (try_advance()) { collect(); }
+    }
+
+    // Advance the epoch if no live reader is left in the previous one. Only
+    // the updater advances the epoch of a segment.
+    bool
+    try_advance()
+    {
+        auto&    ctrl  = m_segment.control();
+        uint64_t epoch = ctrl.epoch.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < ctrl.layout.readerSlots; ++i)
+        {
+            auto& slot = m_segment.slots()[i];
+            if (slot.pid.load(std::memory_order_acquire) == 0) { continue; }
+            if (slot.counts[(epoch - 1) & 1].load(std::memory_order_seq_cst)
+                && !detail::reap_if_dead(slot))
+            {
+                return false;
+            }
+        }
+        ctrl.epoch.store(epoch + 1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Move the blocks retired at least two epochs ago to the free list.
+    void
+    collect()
+    {
+        uint64_t epoch =
+            m_segment.control().epoch.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < 2; ++i)
+        {
+            auto& retired = m_retireLists[i];
+            if (retired.empty() || m_retireEpochs[i] + 2 > epoch) { continue; }
+            m_free.insert(m_free.end(), retired.begin(), retired.end());
+            retired.clear();
+        }
+    }
+};
+
+// Read-only view of a segment created by shm_rcu_protected in another
+// process. Must be constructed after any fork, since the reader slot it
+// takes belongs to the constructing process.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+class shm_rcu_reader
+{
+public:
+    explicit shm_rcu_reader(std::string name)
+        : m_segment{std::move(name)}, m_slot{&m_segment.claim_slot()}
+    {}
+
+    shm_rcu_reader(shm_rcu_reader const&)            = delete;
+    shm_rcu_reader& operator=(shm_rcu_reader const&) = delete;
+
+    ~shm_rcu_reader() { m_slot->pid.store(0, std::memory_order_release); }
+
+    // Returns a protected pointer to the current version. The version is
+    // mapped read-only.
+    auto
+    get_ptr() noexcept
+    {
+        uint32_t parity;
+        T const* ptr     = m_segment.lock(*m_slot, parity);
+        auto     deleter = [slot = m_slot, parity](T const*)
+        { detail::ShmSegment<T>::unlock(*slot, parity); };
+        return std::unique_ptr<T const, decltype(deleter)>(ptr, deleter);
+    }
+
+    uint64_t
+    version() const noexcept
+    {
+        return m_segment.control().version.load(std::memory_order_acquire);
+    }
+
+private:
+    detail::ShmSegment<T>  m_segment;
+    detail::ShmReaderSlot* m_slot;
+};
+
+} // namespace wbrcu
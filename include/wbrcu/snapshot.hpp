@@ -0,0 +1,308 @@
+#pragma once
+
+#include "detail/Errno.hpp"
+#include <cerrno>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <fcntl.h>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace wbrcu
+{
+
+// Header of a snapshot file. The payload written by the serializer follows at
+// payloadOffset, which keeps it aligned for types up to 64 bytes when the
+// file is mapped.
+struct snapshot_header
+{
+    constexpr static uint64_t    magicValue    = 0x70616e7375726277; // wbrusnap
+    constexpr static uint32_t    formatVersion = 1;
+    constexpr static std::size_t payloadOffset = 64;
+
+    uint64_t magic;
+    uint32_t format;
+    uint32_t offset;
+    uint64_t payloadSize;
+};
+
+static_assert(sizeof(snapshot_header) <= snapshot_header::payloadOffset);
+
+// Buffered output of a serializer into a snapshot file.
+class snapshot_sink
+{
+public:
+    explicit snapshot_sink(int fd) : m_fd{fd} { m_buffer.reserve(bufferSize); }
+
+    void
+    write(void const* data, std::size_t size)
+    {
+        auto const* bytes = static_cast<std::byte const*>(data);
+        m_size += size;
+        if (m_buffer.size() + size > bufferSize)
+        {
+            flush();
+            if (size >= bufferSize)
+            {
+                write_all(bytes, size);
+                return;
+            }
+        }
+        m_buffer.insert(m_buffer.end(), bytes, bytes + size);
+    }
+
+    // Number of payload bytes written so far.
+    uint64_t
+    size() const noexcept
+    {
+        return m_size;
+    }
+
+    void
+    flush()
+    {
+        write_all(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+
+private:
+    constexpr static std::size_t bufferSize = 1 << 16;
+
+    int                    m_fd;
+    std::vector<std::byte> m_buffer;
+    uint64_t               m_size = 0;
+
+    void
+    write_all(std::byte const* data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            ssize_t written = ::write(m_fd, data, size);
+            if (written < 0)
+            {
+                if (errno == EINTR) { continue; }
+                detail::throw_errno("snapshot write");
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+};
+
+// Writes the bytes of a trivially copyable T, so that the snapshot can be
+// mapped and used in place.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+struct raw_serializer
+{
+    void
+    operator()(T const& value, snapshot_sink& sink) const
+    {
+        sink.write(&value, sizeof(T));
+    }
+};
+
+namespace detail
+{
+
+// Temporary file a snapshot is written to, removed unless committed.
+class SnapshotFile
+{
+public:
+    explicit SnapshotFile(std::filesystem::path path) : m_path{std::move(path)}
+    {
+        m_fd = ::open(
+            m_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644
+        );
+        if (m_fd < 0) { throw_errno("snapshot open"); }
+    }
+
+    SnapshotFile(SnapshotFile const&)            = delete;
+    SnapshotFile& operator=(SnapshotFile const&) = delete;
+
+    ~SnapshotFile()
+    {
+        if (m_fd >= 0) { ::close(m_fd); }
+        if (!m_committed) { ::unlink(m_path.c_str()); }
+    }
+
+    int
+    fd() const noexcept
+    {
+        return m_fd;
+    }
+
+    // Makes the file durable and moves it to path.
+    void
+    commit(std::filesystem::path const& path)
+    {
+        if (::fdatasync(m_fd) != 0) { throw_errno("snapshot fdatasync"); }
+        int fd = std::exchange(m_fd, -1);
+        if (::close(fd) != 0) { throw_errno("snapshot close"); }
+        if (::rename(m_path.c_str(), path.c_str()) != 0)
+        {
+            throw_errno("snapshot rename");
+        }
+        m_committed = true;
+    }
+
+private:
+    std::filesystem::path m_path;
+    int                   m_fd        = -1;
+    bool                  m_committed = false;
+};
+
+// Writes the snapshot beside path and renames it, so that path always names
+// a complete snapshot.
+void
+write_snapshot(
+    std::filesystem::path const&           path,
+    std::invocable<snapshot_sink&> auto&& serialize
+)
+{
+    auto tmp = path;
+    tmp += ".tmp";
+    SnapshotFile file{tmp};
+
+    if (::lseek(file.fd(), snapshot_header::payloadOffset, SEEK_SET) < 0)
+    {
+        throw_errno("snapshot seek");
+    }
+    snapshot_sink sink{file.fd()};
+    serialize(sink);
+    sink.flush();
+
+    snapshot_header header{
+        snapshot_header::magicValue,
+        snapshot_header::formatVersion,
+        snapshot_header::payloadOffset,
+        sink.size()
+    };
+    if (::pwrite(file.fd(), &header, sizeof(header), 0) != sizeof(header))
+    {
+        throw_errno("snapshot write");
+    }
+    file.commit(path);
+}
+
+} // namespace detail
+
+// Serializes the current object of rp into a snapshot file at path on
+// a background thread, and returns a future that is ready once the file is
+// complete, or holds the std::system_error of a failed write. Like any future
+// of std::async, it blocks in its destructor until the file is written, so
+// the caller must keep it for the export to run in the background.
+//
+// The object is held with rp.pin() rather than a read-side critical
+// section, so the export neither blocks readers and updaters nor holds back
+// grace periods. The exported version is only reclaimed once the export has
+// finished. serializer is called as serializer(object, sink) and
+// writes the payload with sink.write(data, size). rp must outlive the export.
+template <
+    typename Protected,
+    typename Serializer = raw_serializer<typename Protected::value_type>>
+    requires requires(Protected& p) { p.pin(); }
+[[nodiscard]] std::future<void>
+export_snapshot(
+    Protected& rp, std::filesystem::path path, Serializer serializer = {}
+)
+{
+    return std::async(
+        std::launch::async,
+        [pinned     = rp.pin(),
+         path       = std::move(path),
+         serializer = std::move(serializer)]() mutable
+        {
+            detail::write_snapshot(
+                path,
+                [&](snapshot_sink& sink) { serializer(*pinned, sink); }
+            );
+        }
+    );
+}
+
+// Unmaps a snapshot mapped by map_snapshot.
+struct snapshot_unmapper
+{
+    void*       base   = nullptr;
+    std::size_t length = 0;
+
+    void
+    operator()(void const*) const noexcept
+    {
+        ::munmap(base, length);
+    }
+};
+
+template <typename T>
+using mapped_snapshot = std::unique_ptr<T const, snapshot_unmapper>;
+
+// Maps a snapshot of a trivially copyable T written by export_snapshot with
+// raw_serializer, and returns the object in place. Nothing is read or copied
+// up front, pages are faulted in as the object is accessed. The mapping is
+// read-only and private, so the file may be replaced by a later export while
+// mapped.
+//
+// Passing the result to rcu_protected's adopting constructor serves the
+// snapshot as the initial version until the first update copies it.
+template <typename T>
+    requires std::is_trivially_copyable_v<T>
+mapped_snapshot<T>
+map_snapshot(std::filesystem::path const& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { detail::throw_errno("snapshot open"); }
+    struct stat st;
+    if (::fstat(fd, &st) != 0)
+    {
+        int error = errno;
+        ::close(fd);
+        throw std::system_error(
+            error, std::generic_category(), "snapshot stat"
+        );
+    }
+    auto  length = static_cast<std::size_t>(st.st_size);
+    void* base   = length >= sizeof(snapshot_header)
+                     ? ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0)
+                     : MAP_FAILED;
+    int   error  = errno;
+    ::close(fd);
+    if (length < sizeof(snapshot_header))
+    {
+        throw std::runtime_error("wbrcu: snapshot file is truncated");
+    }
+    if (base == MAP_FAILED)
+    {
+        throw std::system_error(
+            error, std::generic_category(), "snapshot mmap"
+        );
+    }
+
+    snapshot_unmapper unmapper{base, length};
+    auto const&       header = *static_cast<snapshot_header const*>(base);
+    if (header.magic != snapshot_header::magicValue
+        || header.format != snapshot_header::formatVersion
+        || header.payloadSize != sizeof(T) || header.offset % alignof(T) != 0
+        || header.offset + header.payloadSize > length)
+    {
+        unmapper(nullptr);
+        throw std::runtime_error("wbrcu: snapshot does not hold a T");
+    }
+    return mapped_snapshot<T>(
+        reinterpret_cast<T const*>(
+            static_cast<std::byte const*>(base) + header.offset
+        ),
+        unmapper
+    );
+}
+
+} // namespace wbrcu
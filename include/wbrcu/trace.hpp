@@ -0,0 +1,260 @@
+#pragma once
+
+#include "detail/Errno.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace wbrcu
+{
+
+enum class trace_kind : uint8_t
+{
+    read,
+    update,
+};
+
+// One read-side critical section or update call of a traced object. start is
+// relative to the creation of the recorder, duration is how long the reader
+// held its pointer, or how long update took to return to its caller.
+struct trace_event
+{
+    uint64_t   start_ns;
+    uint32_t   duration_ns;
+    uint16_t   thread;
+    trace_kind kind;
+    uint8_t    reserved = 0;
+};
+
+static_assert(sizeof(trace_event) == 16);
+
+namespace detail
+{
+
+// Header of a trace file, followed by count trace_events.
+struct TraceHeader
+{
+    constexpr static uint64_t magicValue = 0x3165636172747277; // wrtrace1
+
+    uint64_t magic;
+    uint64_t count;
+};
+
+} // namespace detail
+
+// Collects the trace_events of the objects traced with trace_to, which only
+// exists when WBRCU_TRACING is defined; without it tracing compiles to
+// nothing. The definition changes the layout of the protected types, so it
+// must be the same in every file of a program, see the WBRCU_TRACING option
+// of the CMake project.
+//
+// Every thread appends to a buffer of its own, numbered in the order threads
+// first record. A thread caches the buffers of the last few recorders it
+// recorded to, so recording takes no lock after its first event unless it
+// alternates between more recorders. An event that cannot be stored for lack
+// of memory is dropped and counted, see dropped.
+//
+// write and events must only be called once the traced objects are no longer
+// used.
+class trace_recorder
+{
+public:
+    trace_recorder()
+        : m_id{nextId.fetch_add(1, std::memory_order_relaxed)}
+        , m_epoch{std::chrono::steady_clock::now()}
+    {}
+
+    trace_recorder(trace_recorder const&)            = delete;
+    trace_recorder& operator=(trace_recorder const&) = delete;
+
+    // Nanoseconds since the recorder was created.
+    uint64_t
+    now() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - m_epoch
+        )
+            .count();
+    }
+
+    void
+    record(trace_kind kind, uint64_t start) noexcept
+    {
+        uint64_t duration = now() - start;
+        try
+        {
+            Buffer& buffer = local_buffer();
+            buffer.events.push_back(trace_event{
+                start,
+                static_cast<uint32_t>(std::min<uint64_t>(duration, UINT32_MAX)),
+                buffer.thread,
+                kind
+            });
+        }
+        catch (std::bad_alloc const&)
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Number of events dropped because they could not be stored.
+    uint64_t
+    dropped() const noexcept
+    {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+
+    // Events of all threads, ordered by start.
+    std::vector<trace_event>
+    events() const
+    {
+        std::vector<trace_event> all;
+        std::scoped_lock         lock{m_mutex};
+        for (auto const& buffer : m_buffers)
+        {
+            all.insert(all.end(), buffer.events.begin(), buffer.events.end());
+        }
+        std::stable_sort(
+            all.begin(),
+            all.end(),
+            [](auto const& a, auto const& b) { return a.start_ns < b.start_ns; }
+        );
+        return all;
+    }
+
+    // Writes the trace to path: a header followed by the events ordered by
+    // start, see read_trace.
+    void
+    write(std::filesystem::path const& path) const
+    {
+        auto events = this->events();
+        std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{
+            std::fopen(path.c_str(), "wb"), &std::fclose
+        };
+        if (!file) { detail::throw_errno("trace open"); }
+        detail::TraceHeader header{
+            detail::TraceHeader::magicValue, events.size()
+        };
+        if (std::fwrite(&header, sizeof(header), 1, file.get()) != 1
+            || std::fwrite(
+                   events.data(), sizeof(trace_event), events.size(), file.get()
+               ) != events.size())
+        {
+            detail::throw_errno("trace write");
+        }
+    }
+
+private:
+    struct Buffer
+    {
+        uint16_t                 thread;
+        std::vector<trace_event> events;
+    };
+
+    // Tells the recorders apart in the thread-local cache of local_buffer,
+    // unlike addresses, which are reused.
+    inline static std::atomic<uint64_t> nextId{1};
+
+    uint64_t                              m_id;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::atomic<uint64_t>                 m_dropped{0};
+    mutable std::mutex                    m_mutex;
+    // Deque, so that buffers do not move as threads register.
+    std::deque<Buffer>                           m_buffers;
+    std::unordered_map<std::thread::id, Buffer*> m_threads;
+
+    Buffer&
+    local_buffer()
+    {
+        struct Cached
+        {
+            uint64_t id     = 0;
+            Buffer*  buffer = nullptr;
+        };
+        thread_local std::array<Cached, 4> cache;
+        thread_local std::size_t           next = 0;
+        for (auto const& cached : cache)
+        {
+            if (cached.id == m_id) { return *cached.buffer; }
+        }
+
+        // A thread keeps its buffer when it falls out of the cache.
+        Buffer* buffer;
+        {
+            std::scoped_lock lock{m_mutex};
+            auto& registered = m_threads[std::this_thread::get_id()];
+            if (!registered)
+            {
+                registered = &m_buffers.emplace_back(
+                    Buffer{static_cast<uint16_t>(m_buffers.size()), {}}
+                );
+            }
+            buffer = registered;
+        }
+        cache[next++ % cache.size()] = {m_id, buffer};
+        return *buffer;
+    }
+};
+
+// Reads a trace written by trace_recorder::write.
+inline std::vector<trace_event>
+read_trace(std::filesystem::path const& path)
+{
+    std::unique_ptr<std::FILE, int (*)(std::FILE*)> file{
+        std::fopen(path.c_str(), "rb"), &std::fclose
+    };
+    if (!file) { detail::throw_errno("trace open"); }
+    detail::TraceHeader header;
+    if (std::fread(&header, sizeof(header), 1, file.get()) != 1
+        || header.magic != detail::TraceHeader::magicValue)
+    {
+        throw std::runtime_error("wbrcu: not a trace file");
+    }
+    std::vector<trace_event> events(header.count);
+    std::size_t read =
+        std::fread(events.data(), sizeof(trace_event), events.size(), file.get());
+    if (read != events.size())
+    {
+        throw std::runtime_error("wbrcu: trace file is truncated");
+    }
+    return events;
+}
+
+namespace detail
+{
+
+// Records the enclosing update call of a traced object.
+class TraceScope
+{
+public:
+    explicit TraceScope(trace_recorder* recorder) noexcept
+        : m_recorder{recorder}, m_start{recorder ? recorder->now() : 0}
+    {}
+
+    TraceScope(TraceScope const&)            = delete;
+    TraceScope& operator=(TraceScope const&) = delete;
+
+    ~TraceScope()
+    {
+        if (m_recorder) { m_recorder->record(trace_kind::update, m_start); }
+    }
+
+private:
+    trace_recorder* m_recorder;
+    uint64_t        m_start;
+};
+
+} // namespace detail
+
+} // namespace wbrcu
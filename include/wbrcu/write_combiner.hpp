@@ -0,0 +1,90 @@
+#pragma once
+
+#include "folly/ThreadLocal.h"
+#include <concepts>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+namespace wbrcu
+{
+
+// Opt-in commutative update mode for a protected object, e.g. rcu_protected
+// or seqlock_protected.
+//
+// Instead of enqueueing every update, each writer thread folds its updates
+// into a thread-local Delta with combine. The first fold after a flush
+// enqueues a single update that merges the thread's pending Delta into the
+// updater's copy with Merge, so N updates from a thread within a batch cost
+// one queue operation and one merge. Updates must therefore commute: the
+// order in which deltas of different threads are merged is unspecified.
+//
+// Delta must be default constructible, a value-initialized Delta being the
+// identity. Merge is called as merge(T*, Delta&&) by the updater. The
+// protected object must outlive the combiner, and must not be destroyed while
+// merges are still queued.
+template <typename Protected, typename Delta, typename Merge>
+    requires std::default_initializable<Delta>
+class write_combiner
+{
+public:
+    explicit write_combiner(Protected& protectedObj, Merge merge = {})
+        : m_protected{protectedObj}, m_merge{std::move(merge)}
+    {}
+
+    // Folds an update into the calling thread's delta. It is visible to
+    // readers once the updater has merged the delta and published.
+    template <std::invocable<Delta&> Fold>
+    void
+    combine(Fold&& fold)
+    {
+        auto const& slot = m_slots->slot;
+        bool        mustEnqueue;
+        {
+            std::scoped_lock lock{slot->mutex};
+            std::invoke(std::forward<Fold>(fold), slot->delta);
+            mustEnqueue   = !slot->pending;
+            slot->pending = true;
+        }
+        // Enqueue outside the lock, we may become the updater and run the
+        // merge of our own slot.
+        if (mustEnqueue)
+        {
+            m_protected.update(
+                [slot, merge = m_merge](auto* obj) mutable
+                {
+                    Delta delta{};
+                    {
+                        std::scoped_lock lock{slot->mutex};
+                        std::swap(delta, slot->delta);
+                        slot->pending = false;
+                    }
+                    merge(obj, std::move(delta));
+                }
+            );
+        }
+    }
+
+private:
+    // Pending delta of one writer thread. Shared with the queued merge so
+    // that it outlives its thread.
+    struct Slot
+    {
+        std::mutex mutex;
+        Delta      delta{};
+        // Whether a merge of this slot is queued and has not run yet.
+        bool pending = false;
+    };
+
+    struct SlotHandle
+    {
+        std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+    };
+
+    Protected&                     m_protected;
+    [[no_unique_address]] Merge    m_merge;
+    folly::ThreadLocal<SlotHandle> m_slots;
+};
+
+} // namespace wbrcu
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+#include <unistd.h>
+#include "wbrcu/journal.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/rcu_transaction.hpp"
+
+namespace {
+
+struct Counters {
+    struct Add {
+        int index;
+        int delta;
+    };
+    using command = std::variant<Add>;
+
+    std::array<int, 8> values{};
+
+    void apply(Add const& cmd) { values[cmd.index] += cmd.delta; }
+};
+
+std::filesystem::path journal_path(char const* test) {
+    auto path = std::filesystem::temp_directory_path()
+        / ("wbrcu_journal_" + std::string(test) + "_" + std::to_string(getpid()));
+    std::filesystem::remove(path);
+    return path;
+}
+
+} // namespace
+
+TEST(JournalTest, ReplayRebuildsState) {
+    constexpr int num_threads = 4;
+    constexpr int num_updates = 200;
+    auto path = journal_path("replay");
+
+    wbrcu::journal<Counters::command> journal{path};
+    wbrcu::command_protected<Counters> p{new Counters{}};
+    p.journal_to(journal);
+
+    std::vector<std::thread> writers;
+    for (int t = 0; t < num_threads; ++t) {
+        writers.emplace_back([&, t]() {
+            for (int i = 0; i < num_updates; ++i) {
+                p.update_sync(Counters::Add{t, 1});
+                // Returned only after the update was published.
+                EXPECT_GE(p.get_ptr()->values[t], i + 1);
+            }
+        });
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+
+    Counters replayed;
+    std::set<uint64_t> batches;
+    uint64_t last = wbrcu::journal<Counters::command>::replay(
+        path, [&](uint64_t version, Counters::command const& cmd) {
+            batches.insert(version);
+            std::visit([&](auto const& c) { replayed.apply(c); }, cmd);
+        });
+    EXPECT_EQ(last, p.version());
+    EXPECT_EQ(replayed.values, p.get_ptr()->values);
+    // One frame per published batch, shared by the updates of the batch.
+    EXPECT_EQ(batches.size(), p.version());
+    std::filesystem::remove(path);
+}
+
+TEST(JournalTest, TornFrameIsIgnored) {
+    auto path = journal_path("torn");
+    {
+        wbrcu::journal<Counters::command> journal{path};
+        wbrcu::command_protected<Counters> p{new Counters{}};
+        p.journal_to(journal);
+        p.update(Counters::Add{0, 5});
+        p.update(Counters::Add{1, 7});
+    }
+    {
+        // A crash in the middle of appending a frame.
+        std::ofstream out(path, std::ios::binary | std::ios::app);
+        std::array<char, 30> partial{};
+        partial[8] = 1;
+        out.write(partial.data(), partial.size());
+    }
+
+    auto replay = [&path](Counters& replayed) {
+        return wbrcu::journal<Counters::command>::replay(
+            path, [&](uint64_t, Counters::command const& cmd) {
+                std::visit([&](auto const& c) { replayed.apply(c); }, cmd);
+            });
+    };
+    Counters replayed;
+    EXPECT_EQ(replay(replayed), 2u);
+    EXPECT_EQ(replayed.values[0], 5);
+    EXPECT_EQ(replayed.values[1], 7);
+
+    // After a restart, frames are appended past the cut-off torn frame, with
+    // versions that go on from the last frame.
+    {
+        wbrcu::journal<Counters::command> journal{path};
+        EXPECT_EQ(journal.base_version(), 2u);
+        wbrcu::command_protected<Counters> p{new Counters{}};
+        p.journal_to(journal);
+        p.update(Counters::Add{2, 9});
+    }
+    Counters restarted;
+    EXPECT_EQ(replay(restarted), 3u);
+    EXPECT_EQ(restarted.values[0], 5);
+    EXPECT_EQ(restarted.values[1], 7);
+    EXPECT_EQ(restarted.values[2], 9);
+    std::filesystem::remove(path);
+}
+
+TEST(JournalTest, UpdateTogetherRejectsJournaledObjects) {
+    auto path = journal_path("together");
+    wbrcu::journal<Counters::command> journal{path};
+    wbrcu::rcu_domain<> domain;
+    wbrcu::command_protected<Counters> journaled{new Counters{}, domain};
+    wbrcu::command_protected<Counters> plain{new Counters{}, domain};
+    journaled.journal_to(journal);
+
+    auto add = [](Counters* a, Counters* b) {
+        a->apply(Counters::Add{0, 1});
+        b->apply(Counters::Add{0, 1});
+    };
+    EXPECT_THROW(wbrcu::update_together(add, journaled, plain), std::logic_error);
+    EXPECT_EQ(journaled.version(), 0u);
+    std::filesystem::remove(path);
+}
+
+TEST(JournalTest, UpdateSyncWithoutJournal) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&]() {
+            for (int i = 0; i < 100; ++i) {
+                int seen = *p.get_ptr();
+                p.update_sync([](int* v) { ++*v; });
+                EXPECT_GT(*p.get_ptr(), seen);
+            }
+        });
+    }
+    for (auto& w : writers) {
+        w.join();
+    }
+    EXPECT_EQ(*p.get_ptr(), 400);
+}
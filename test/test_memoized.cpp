@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "wbrcu/memoized.hpp"
+#include "wbrcu/rcu_protected.hpp"
+
+namespace {
+
+struct Scores {
+    std::vector<int> values;
+    wbrcu::memoized<std::vector<int>> sorted;
+
+    std::vector<int> const& get_sorted() const {
+        return sorted.get([this]() {
+            auto copy = values;
+            std::sort(copy.begin(), copy.end());
+            return copy;
+        });
+    }
+};
+
+} // namespace
+
+TEST(MemoizedTest, ComputedOncePerVersion) {
+    wbrcu::rcu_protected<Scores> p{new Scores{{3, 1, 2}, {}}};
+    std::atomic<int> computed(0);
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i) {
+        readers.emplace_back([&]() {
+            for (int j = 0; j < 100; ++j) {
+                auto ptr = p.get_ptr();
+                auto const& sorted = ptr->sorted.get([&]() {
+                    computed.fetch_add(1);
+                    auto copy = ptr->values;
+                    std::sort(copy.begin(), copy.end());
+                    return copy;
+                });
+                EXPECT_EQ(sorted, (std::vector<int>{1, 2, 3}));
+            }
+        });
+    }
+    for (auto& t : readers) {
+        t.join();
+    }
+    // Racing readers may each compute it, but no later read does.
+    EXPECT_GE(computed.load(), 1);
+    EXPECT_LE(computed.load(), 4);
+    EXPECT_NE(p.get_ptr()->sorted.peek(), nullptr);
+}
+
+TEST(MemoizedTest, NewVersionsStartEmpty) {
+    wbrcu::rcu_protected<Scores> p{new Scores{{3, 1, 2}, {}}};
+    EXPECT_EQ(p.get_ptr()->get_sorted(), (std::vector<int>{1, 2, 3}));
+
+    // Enough updates for the updater to recycle old versions from its pool,
+    // none of which may keep a stale attachment.
+    for (int i = 0; i < 100; ++i) {
+        p.update([i](Scores* s) { s->values.push_back(-i); });
+        auto ptr = p.get_ptr();
+        EXPECT_EQ(ptr->sorted.peek(), nullptr);
+        EXPECT_EQ(ptr->get_sorted().front(), -i);
+        EXPECT_EQ(ptr->get_sorted().size(), static_cast<size_t>(i + 4));
+    }
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wbrcu/rcu_map.hpp"
+
+namespace {
+
+// Maps every key to a handful of hashes so that entries collide on every
+// level of the trie.
+struct CollidingHash {
+    std::size_t operator()(int key) const noexcept { return key % 3; }
+};
+
+} // namespace
+
+TEST(HamtTest, InsertFindErase) {
+    wbrcu::hamt<int, std::string> map;
+    constexpr int num_keys = 10000;
+
+    for (int i = 0; i < num_keys; ++i) {
+        EXPECT_TRUE(map.insert_or_assign(i, std::to_string(i)));
+    }
+    EXPECT_FALSE(map.insert_or_assign(7, "seven"));
+    EXPECT_EQ(map.size(), size_t{num_keys});
+
+    EXPECT_EQ(*map.find(7), "seven");
+    EXPECT_EQ(*map.find(num_keys - 1), std::to_string(num_keys - 1));
+    EXPECT_EQ(map.find(num_keys), nullptr);
+
+    for (int i = 0; i < num_keys; i += 2) {
+        EXPECT_TRUE(map.erase(i));
+    }
+    EXPECT_FALSE(map.erase(0));
+    EXPECT_EQ(map.size(), size_t{num_keys / 2});
+    for (int i = 0; i < num_keys; ++i) {
+        EXPECT_EQ(map.contains(i), i % 2 == 1);
+    }
+
+    size_t visited = 0;
+    map.for_each([&](int key, std::string const&) {
+        EXPECT_EQ(key % 2, 1);
+        ++visited;
+    });
+    EXPECT_EQ(visited, map.size());
+}
+
+TEST(HamtTest, FullHashCollisions) {
+    wbrcu::hamt<int, int, CollidingHash> map;
+    for (int i = 0; i < 30; ++i) {
+        map.insert_or_assign(i, i * 10);
+    }
+    for (int i = 0; i < 30; ++i) {
+        ASSERT_NE(map.find(i), nullptr);
+        EXPECT_EQ(*map.find(i), i * 10);
+    }
+    for (int i = 0; i < 30; ++i) {
+        EXPECT_TRUE(map.erase(i));
+        EXPECT_EQ(map.find(i), nullptr);
+    }
+    EXPECT_TRUE(map.empty());
+}
+
+TEST(HamtTest, CopiesAreIndependent) {
+    wbrcu::hamt<int, int> map;
+    for (int i = 0; i < 1000; ++i) {
+        map.insert_or_assign(i, i);
+    }
+
+    auto copy = map;
+    copy.insert_or_assign(1, 100);
+    copy.erase(2);
+
+    EXPECT_EQ(*map.find(1), 1);
+    EXPECT_EQ(*map.find(2), 2);
+    EXPECT_EQ(*copy.find(1), 100);
+    EXPECT_EQ(copy.find(2), nullptr);
+}
+
+TEST(RcuMapTest, SnapshotIsStable) {
+    wbrcu::rcu_map<int, int> map;
+    map.insert_or_assign(1, 1);
+
+    {
+        auto snapshot = map.get_ptr();
+        std::thread writer([&map]() { map.insert_or_assign(1, 2); });
+        writer.join();
+        EXPECT_EQ(*snapshot->find(1), 1);
+    }
+
+    EXPECT_EQ(map.find(1), 2);
+}
+
+TEST(RcuMapTest, ConcurrentReadsAndUpdates) {
+    constexpr int num_reader_threads = 4;
+    constexpr int num_updater_threads = 3;
+    constexpr int num_operations = 1000;
+
+    wbrcu::rcu_map<int, int> map;
+    std::vector<std::thread> threads;
+    std::atomic<int> bad_reads(0);
+
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < num_operations; ++j) {
+                auto ptr = map.get_ptr();
+                auto const* value = ptr->find(j % 100);
+                if (value && *value != j % 100) {
+                    bad_reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < num_updater_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < num_operations; ++j) {
+                int key = i * num_operations + j;
+                map.insert_or_assign(key, key);
+                if (j % 2) {
+                    map.erase(key);
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(bad_reads.load(), 0);
+    EXPECT_EQ(map.get_ptr()->size(), size_t{num_updater_threads * num_operations / 2});
+}
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wbrcu/rcu_ordered_map.hpp"
+
+TEST(TreapTest, MatchesStdMap) {
+    wbrcu::treap<int, int> treap;
+    std::map<int, int> expected;
+    std::mt19937 rng(42);
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = rng() % 2000;
+        if (rng() % 3) {
+            EXPECT_EQ(treap.insert_or_assign(key, i), !expected.contains(key));
+            expected.insert_or_assign(key, i);
+        } else {
+            EXPECT_EQ(treap.erase(key), expected.erase(key) == 1);
+        }
+    }
+
+    ASSERT_EQ(treap.size(), expected.size());
+    EXPECT_TRUE(std::equal(treap.begin(), treap.end(), expected.begin(), expected.end()));
+    for (int key = -1; key <= 2000; ++key) {
+        auto const* value = treap.find(key);
+        auto it = expected.find(key);
+        ASSERT_EQ(value != nullptr, it != expected.end());
+        if (value) {
+            EXPECT_EQ(*value, it->second);
+        }
+    }
+}
+
+TEST(TreapTest, BoundsAndRanges) {
+    wbrcu::treap<int, int> treap;
+    for (int i = 0; i < 100; i += 10) {
+        treap.insert_or_assign(i, i);
+    }
+
+    EXPECT_EQ(treap.lower_bound(20)->first, 20);
+    EXPECT_EQ(treap.lower_bound(21)->first, 30);
+    EXPECT_EQ(treap.upper_bound(20)->first, 30);
+    EXPECT_EQ(treap.lower_bound(-5)->first, 0);
+    EXPECT_EQ(treap.lower_bound(91), treap.end());
+    EXPECT_EQ(treap.upper_bound(90), treap.end());
+
+    std::vector<int> keys;
+    treap.for_each_in_range(15, 55, [&](int key, int) { keys.push_back(key); });
+    EXPECT_EQ(keys, (std::vector<int>{20, 30, 40, 50}));
+}
+
+TEST(TreapTest, RangesMatchStdMap) {
+    wbrcu::treap<int, int> treap;
+    std::map<int, int> expected;
+    std::mt19937 rng(7);
+    for (int i = 0; i < 5000; ++i) {
+        int key = rng() % 10000;
+        treap.insert_or_assign(key, i);
+        expected.insert_or_assign(key, i);
+    }
+
+    for (int i = 0; i < 200; ++i) {
+        int lo = rng() % 10100 - 50;
+        int hi = lo + rng() % 500;
+        std::vector<std::pair<int, int>> scanned;
+        treap.for_each_in_range(lo, hi, [&](int key, int value) { scanned.emplace_back(key, value); });
+        std::vector<std::pair<int, int>> iterated(treap.lower_bound(lo), treap.lower_bound(hi));
+        std::vector<std::pair<int, int>> wanted(expected.lower_bound(lo), expected.lower_bound(hi));
+        EXPECT_EQ(scanned, wanted);
+        EXPECT_EQ(iterated, wanted);
+    }
+}
+
+TEST(TreapTest, PrefixScan) {
+    wbrcu::treap<std::string, int> treap;
+    for (auto const* route : {"/api/users", "/api/users/1", "/api/v2", "/static", "/ap"}) {
+        treap.insert_or_assign(route, 0);
+    }
+
+    std::vector<std::string> matched;
+    std::string const prefix = "/api/";
+    for (auto it = treap.lower_bound(prefix); it != treap.end() && it->first.starts_with(prefix); ++it) {
+        matched.push_back(it->first);
+    }
+    EXPECT_EQ(matched, (std::vector<std::string>{"/api/users", "/api/users/1", "/api/v2"}));
+}
+
+TEST(TreapTest, CopiesAreIndependent) {
+    wbrcu::treap<int, int> treap;
+    for (int i = 0; i < 1000; ++i) {
+        treap.insert_or_assign(i, i);
+    }
+
+    auto copy = treap;
+    copy.insert_or_assign(1, 100);
+    copy.erase(2);
+
+    EXPECT_EQ(*treap.find(1), 1);
+    EXPECT_EQ(*treap.find(2), 2);
+    EXPECT_EQ(*copy.find(1), 100);
+    EXPECT_EQ(copy.find(2), nullptr);
+    EXPECT_EQ(std::distance(treap.begin(), treap.end()), 1000);
+    EXPECT_EQ(std::distance(copy.begin(), copy.end()), 999);
+}
+
+TEST(RcuOrderedMapTest, ScanDuringUpdates) {
+    constexpr int num_reader_threads = 4;
+    constexpr int num_keys = 1000;
+    constexpr int num_operations = 1000;
+
+    wbrcu::rcu_ordered_map<int, int> map;
+    map.update([](auto* treap) {
+        for (int i = 0; i < num_keys; ++i) {
+            treap->insert_or_assign(i, 0);
+        }
+    });
+
+    std::vector<std::thread> threads;
+    std::atomic<int> bad_scans(0);
+
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < num_operations; ++j) {
+                auto ptr = map.get_ptr();
+                int lo = (i * 97 + j) % num_keys;
+                int expected = lo;
+                ptr->for_each_in_range(lo, lo + 50, [&](int key, int) {
+                    if (key != expected++) {
+                        bad_scans.fetch_add(1, std::memory_order_relaxed);
+                    }
+                });
+            }
+        });
+    }
+
+    // Every version keeps all keys; only the values change.
+    threads.emplace_back([&]() {
+        for (int j = 0; j < num_operations; ++j) {
+            map.insert_or_assign(j % num_keys, j);
+            map.insert_or_assign(num_keys + j, j);
+        }
+    });
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(bad_scans.load(), 0);
+    EXPECT_EQ(map.get_ptr()->size(), size_t{num_keys + num_operations});
+    EXPECT_EQ(map.find(num_operations - 1), num_operations - 1);
+}
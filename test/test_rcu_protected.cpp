@@ -1,5 +1,16 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
 #include <thread>
+#include <utility>
+#include <variant>
 #include <vector>
 #include "wbrcu/rcu_protected.hpp"
 
@@ -120,6 +131,815 @@ TEST_F(RCUTest, LargeNumberOfUpdates) {
     EXPECT_EQ(ptr->value, num_updates - 1);
 }
 
+TEST(StreamingCopyTest, CopiesUnalignedRanges) {
+    std::vector<unsigned char> src(4096 + 77), dst(src.size() + 64);
+    for (size_t i = 0; i < src.size(); ++i) {
+        src[i] = static_cast<unsigned char>(i * 7);
+    }
+
+    for (size_t offset : {0, 1, 13, 32, 63}) {
+        std::fill(dst.begin(), dst.end(), 0);
+        wbrcu::detail::streaming_copy(dst.data() + offset, src.data(), src.size());
+        EXPECT_TRUE(std::equal(src.begin(), src.end(), dst.begin() + offset));
+    }
+}
+
+TEST(StreamingCopyTest, LargeObjectUpdates) {
+    struct LargeObject {
+        uint64_t data[(2 << 20) / sizeof(uint64_t)];
+    };
+    static_assert(wbrcu::use_streaming_copy<LargeObject>::value);
+
+    auto* initial = new LargeObject;
+    std::fill(std::begin(initial->data), std::end(initial->data), 1);
+    wbrcu::rcu_protected<LargeObject> rcu_obj{initial};
+
+    constexpr int num_updates = 100;
+    for (int i = 0; i < num_updates; ++i) {
+        rcu_obj.update([i](LargeObject* obj) { obj->data[i] += i; });
+    }
+
+    auto ptr = rcu_obj.get_ptr();
+    for (int i = 0; i < num_updates; ++i) {
+        EXPECT_EQ(ptr->data[i], uint64_t(1 + i));
+    }
+    EXPECT_EQ(ptr->data[num_updates], 1u);
+}
+
+TEST(ClonerTest, NonCopyableTypeWithCustomCloner) {
+    struct Owner {
+        std::unique_ptr<int> value;
+    };
+    struct OwnerCloner {
+        Owner* clone(Owner const& src) const {
+            return new Owner{std::make_unique<int>(*src.value)};
+        }
+        void clone_into(Owner& dst, Owner const& src) const {
+            *dst.value = *src.value;
+        }
+    };
+
+    wbrcu::rcu_protected<Owner, 0, 20, OwnerCloner> rcu_obj{
+        new Owner{std::make_unique<int>(0)}
+    };
+
+    constexpr int num_updates = 1000;
+    for (int i = 0; i < num_updates; ++i) {
+        rcu_obj.update([](Owner* obj) { ++*obj->value; });
+    }
+
+    auto ptr = rcu_obj.get_ptr();
+    EXPECT_EQ(*ptr->value, num_updates);
+}
+
+TEST(ClonerTest, PoolIsReusedAcrossEpochAdvances) {
+    struct CountingCloner {
+        int* clones;
+        int* clone_intos;
+        int* clone(int const& src) const {
+            ++*clones;
+            return new int(src);
+        }
+        void clone_into(int& dst, int const& src) const {
+            ++*clone_intos;
+            dst = src;
+        }
+    };
+
+    int clones = 0;
+    int clone_intos = 0;
+    wbrcu::rcu_protected<int, 0, 20, CountingCloner> rcu_obj{
+        new int(0), CountingCloner{&clones, &clone_intos}
+    };
+
+    // Every cleanupThreshold retires advance the epoch, after which the
+    // reclaimed objects must serve the following copies.
+    constexpr int num_updates = 10000;
+    for (int i = 0; i < num_updates; ++i) {
+        rcu_obj.update([](int* v) { ++*v; });
+    }
+
+    EXPECT_EQ(*rcu_obj.get_ptr(), num_updates);
+    EXPECT_EQ(clones + clone_intos, num_updates);
+    EXPECT_LE(clones, 4 * int(wbrcu::hardware_concurrency));
+}
+
+TEST(ClonerTest, SharesUnchangedParts) {
+    // Persistent singly linked list: pushing to the front copies nothing.
+    struct Node {
+        int value;
+        std::shared_ptr<Node const> next;
+    };
+    struct List {
+        std::shared_ptr<Node const> head;
+    };
+
+    wbrcu::rcu_protected<List> rcu_obj{new List{}};
+    rcu_obj.update([](List* list) {
+        list->head = std::make_shared<Node const>(Node{1, list->head});
+    });
+    Node const* first = rcu_obj.get_ptr()->head.get();
+
+    rcu_obj.update([](List* list) {
+        list->head = std::make_shared<Node const>(Node{2, list->head});
+    });
+
+    auto ptr = rcu_obj.get_ptr();
+    EXPECT_EQ(ptr->head->value, 2);
+    EXPECT_EQ(ptr->head->next.get(), first);
+}
+
+TEST(ClonerTest, ArenaClonerAllocatesFromVersionArena) {
+    struct Names {
+        using allocator_type = std::pmr::polymorphic_allocator<>;
+        std::pmr::vector<std::pmr::string> names;
+
+        explicit Names(allocator_type alloc = {}) : names(alloc) {}
+        Names(Names const& other, allocator_type alloc) : names(other.names, alloc) {}
+    };
+
+    // A small arena, so that later versions outgrow it.
+    wbrcu::arena_cloner<Names> cloner{256};
+    wbrcu::rcu_protected<Names, 0, 20, wbrcu::arena_cloner<Names>> rcu_obj{
+        cloner.create(), cloner
+    };
+
+    constexpr int num_updates = 200;
+    for (int i = 0; i < num_updates; ++i) {
+        rcu_obj.update([i](Names* obj) {
+            obj->names.emplace_back("a name too long for the small string buffer " + std::to_string(i));
+        });
+    }
+
+    auto ptr = rcu_obj.get_ptr();
+    ASSERT_EQ(ptr->names.size(), static_cast<size_t>(num_updates));
+    for (int i = 0; i < num_updates; ++i) {
+        EXPECT_EQ(std::string_view(ptr->names[i]), "a name too long for the small string buffer " + std::to_string(i));
+        EXPECT_EQ(ptr->names[i].get_allocator(), ptr->names.get_allocator());
+    }
+    EXPECT_NE(ptr->names.get_allocator().resource(), std::pmr::get_default_resource());
+
+    // The cloner argument defaults to a default-constructed arena_cloner,
+    // whose constructor is explicit.
+    wbrcu::rcu_protected<Names, 0, 20, wbrcu::arena_cloner<Names>> defaulted{
+        wbrcu::arena_cloner<Names>{}.create()
+    };
+    defaulted.update([](Names* obj) { obj->names.emplace_back("a name"); });
+    EXPECT_EQ(defaulted.get_ptr()->names.size(), 1u);
+}
+
+TEST(DomainTest, InstancesShareDomain) {
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<long> second{new long(0), domain};
+    EXPECT_EQ(&first.domain(), &second.domain());
+
+    constexpr int num_operations = 1000;
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            first.update([](int* v) { ++*v; });
+        }
+    });
+    threads.emplace_back([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            second.update([](long* v) { ++*v; });
+        }
+    });
+    threads.emplace_back([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            std::scoped_lock guard{domain};
+            EXPECT_LE(*first.get_raw_ptr(), num_operations);
+            EXPECT_LE(*second.get_raw_ptr(), num_operations);
+        }
+    });
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(*first.get_ptr(), num_operations);
+    EXPECT_EQ(*second.get_ptr(), num_operations);
+}
+
+TEST(DomainTest, CallbacksWaitForReaders) {
+    wbrcu::rcu_domain<> domain;
+    std::atomic<int> called(0);
+
+    domain.lock();
+    for (int i = 0; i < 100; ++i) {
+        domain.call_after_grace_period([&called]() { called.fetch_add(1); });
+    }
+    // The reader that locked before the callbacks were registered blocks
+    // them.
+    EXPECT_EQ(called.load(), 0);
+    domain.unlock();
+
+    domain.barrier();
+    EXPECT_EQ(called.load(), 100);
+}
+
+TEST(DomainTest, RetireFromManyThreads) {
+    constexpr int num_threads = 4;
+    constexpr int num_operations = 1000;
+    std::atomic<int> deleted(0);
+    auto deleter = [&deleted](int* p) {
+        delete p;
+        deleted.fetch_add(1);
+    };
+
+    {
+        wbrcu::rcu_domain<> domain;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&]() {
+                for (int j = 0; j < num_operations; ++j) {
+                    std::scoped_lock guard{domain};
+                    domain.retire(new int(j), deleter);
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+        EXPECT_LE(deleted.load(), num_threads * num_operations);
+    }
+    // Destroying the domain runs whatever was still pending.
+    EXPECT_EQ(deleted.load(), num_threads * num_operations);
+}
+
+TEST(KeyedUpdateTest, LatestUpdatePerKeyWins) {
+    struct Flags {
+        int a = 0;
+        int b = 0;
+        std::vector<int> log;
+    };
+    wbrcu::rcu_protected<Flags> p{new Flags{}};
+    std::atomic<bool> registered(false);
+    std::atomic<bool> release(false);
+    std::atomic<int> applied(0);
+
+    // Hold the updater role so that the updates below end up in one batch:
+    // 18 of them, below the flushing threshold of 20.
+    std::thread updater([&]() {
+        p.update([&](Flags*) {
+            registered = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+    });
+    while (!registered) {
+        std::this_thread::yield();
+    }
+
+    for (int i = 1; i <= 8; ++i) {
+        p.update_keyed(0, [&, i](Flags* f) { f->a = i; applied.fetch_add(1); });
+        p.update_keyed(1, [&, i](Flags* f) { f->b = i; applied.fetch_add(1); });
+    }
+    p.update([](Flags* f) { f->log.push_back(f->a); });
+    p.update_keyed(0, [&](Flags* f) { f->a = 100; applied.fetch_add(1); });
+    release = true;
+    updater.join();
+
+    auto ptr = p.get_ptr();
+    EXPECT_EQ(ptr->a, 100);
+    EXPECT_EQ(ptr->b, 8);
+    // The unkeyed update saw the keyed updates enqueued before it.
+    EXPECT_EQ(ptr->log, std::vector<int>{8});
+    EXPECT_EQ(applied.load(), 3);
+}
+
+TEST(KeyedUpdateTest, ConcurrentToggles) {
+    constexpr int num_threads = 4;
+    constexpr int num_operations = 1000;
+    wbrcu::rcu_protected<std::array<int, num_threads>> p{new std::array<int, num_threads>{}};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 1; j <= num_operations; ++j) {
+                p.update_keyed(i, [i, j](auto* flags) { (*flags)[i] = j; });
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    auto ptr = p.get_ptr();
+    for (int i = 0; i < num_threads; ++i) {
+        EXPECT_EQ((*ptr)[i], num_operations);
+    }
+}
+
+namespace {
+
+struct Limits {
+    struct Set {
+        int index;
+        int value;
+    };
+    struct Add {
+        int index;
+        int delta;
+    };
+    using command = std::variant<Set, Add>;
+
+    std::array<int, 4> values{};
+
+    void apply(Set const& cmd) { values[cmd.index] = cmd.value; }
+    void apply(Add const& cmd) { values[cmd.index] += cmd.delta; }
+};
+
+static_assert(wbrcu::command_set_for<Limits::command, Limits>);
+static_assert(!wbrcu::command_set_for<Limits::command, int>);
+
+} // namespace
+
+TEST(CommandTest, AppliesCommands) {
+    wbrcu::command_protected<Limits> p{new Limits{}};
+    p.update(Limits::Set{0, 5});
+    p.update(Limits::Add{0, 2});
+    p.update(Limits::command{Limits::Add{1, 3}});
+    p.update_keyed(2, Limits::Set{2, 7});
+
+    auto ptr = p.get_ptr();
+    EXPECT_EQ(ptr->values, (std::array<int, 4>{7, 3, 7, 0}));
+}
+
+TEST(CommandTest, ConcurrentCommands) {
+    constexpr int num_threads = 4;
+    constexpr int num_operations = 1000;
+    wbrcu::command_protected<Limits> p{new Limits{}};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&, i]() {
+            for (int j = 0; j < num_operations; ++j) {
+                p.update(Limits::Add{i, 1});
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    auto ptr = p.get_ptr();
+    for (int i = 0; i < num_threads; ++i) {
+        EXPECT_EQ(ptr->values[i], num_operations);
+    }
+}
+
+TEST(PublishHookTest, InlineHookSeesAppliedCommands) {
+    wbrcu::command_protected<Limits> p{new Limits{}};
+    std::vector<int> indexes;
+    uint64_t last_version = 0;
+    p.on_publish([&](auto const& event) {
+        EXPECT_EQ(event.version, last_version + 1);
+        last_version = event.version;
+        for (auto const& command : event.applied) {
+            auto const& set = std::get<Limits::Set>(command);
+            EXPECT_EQ(event.current->values[set.index], set.value);
+            indexes.push_back(set.index);
+        }
+    });
+
+    p.update(Limits::Set{1, 10});
+    p.update(Limits::Set{2, 20});
+    EXPECT_EQ(last_version, 2u);
+    EXPECT_EQ(indexes, (std::vector<int>{1, 2}));
+}
+
+TEST(PublishHookTest, HookMaySubscribeAnotherHook) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::vector<uint64_t> seen;
+    bool subscribed = false;
+    p.on_publish([&](auto const&) {
+        if (!std::exchange(subscribed, true)) {
+            p.on_publish([&](auto const& event) { seen.push_back(event.version); });
+        }
+    });
+
+    p.update([](int* v) { ++*v; });
+    p.update([](int* v) { ++*v; });
+    EXPECT_EQ(seen, (std::vector<uint64_t>{2}));
+}
+
+TEST(PublishHookTest, DeferredHooksPinTheirVersions) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::vector<folly::Function<void()>> tasks;
+    std::atomic<int> checked(0);
+    p.on_publish(
+        [&](auto const& event) {
+            EXPECT_EQ(*event.current, *event.previous + 1);
+            checked.fetch_add(1);
+        },
+        [&](folly::Function<void()> task) { tasks.push_back(std::move(task)); }
+    );
+
+    // Without the pins, these updates would recycle the versions the queued
+    // events refer to.
+    for (int i = 1; i <= 100; ++i) {
+        p.update([](int* v) { ++*v; });
+    }
+    EXPECT_EQ(checked.load(), 0);
+    for (auto& task : tasks) {
+        task();
+    }
+    EXPECT_EQ(checked.load(), 100);
+    EXPECT_EQ(*p.get_ptr(), 100);
+}
+
+TEST(HistoryTest, ReadsVersionsInWindow) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    p.keep_history(4);
+
+    for (int i = 1; i <= 10; ++i) {
+        p.update([i](int* v) { *v = i * 10; });
+    }
+    ASSERT_EQ(p.version(), 10u);
+    for (uint64_t v = 7; v <= 10; ++v) {
+        auto ptr = p.get_version(v);
+        ASSERT_NE(ptr, nullptr);
+        EXPECT_EQ(*ptr, static_cast<int>(v) * 10);
+    }
+    EXPECT_EQ(p.get_version(6), nullptr);
+    EXPECT_EQ(p.get_version(11), nullptr);
+}
+
+TEST(HistoryTest, OldVersionsStayValidWhileRead) {
+    constexpr int num_updates = 2000;
+    wbrcu::rcu_protected<std::array<int, 16>> p{new std::array<int, 16>{}};
+    p.keep_history(8);
+
+    std::atomic<bool> done(false);
+    std::thread writer([&]() {
+        for (int i = 1; i <= num_updates; ++i) {
+            p.update([i](auto* a) { a->fill(i); });
+        }
+        done = true;
+    });
+
+    // Every version found must be the one asked for, and stay intact while
+    // the writer evicts it from the window.
+    while (!done) {
+        uint64_t version = p.version();
+        uint64_t wanted = version > 4 ? version - 4 : 0;
+        if (auto ptr = p.get_version(wanted)) {
+            for (int value : *ptr) {
+                EXPECT_EQ(value, static_cast<int>(wanted));
+            }
+        }
+    }
+    writer.join();
+}
+
+TEST(PinTest, PinnedVersionDoesNotStallEpochs) {
+    wbrcu::rcu_protected<std::array<int, 16>> p{new std::array<int, 16>{}};
+    p.update([](auto* a) { a->fill(1); });
+
+    auto pinned = p.pin();
+    uint64_t epoch = p.domain().epoch();
+    for (int i = 2; i <= 200; ++i) {
+        p.update([i](auto* a) { a->fill(i); });
+    }
+    // Grace periods went on while the version stayed intact.
+    EXPECT_GT(p.domain().epoch(), epoch + 2);
+    for (int value : *pinned) {
+        EXPECT_EQ(value, 1);
+    }
+    pinned.reset();
+
+    for (int i = 201; i <= 400; ++i) {
+        p.update([i](auto* a) { a->fill(i); });
+    }
+    EXPECT_EQ((*p.get_ptr())[0], 400);
+}
+
+std::atomic<int> live_counted{0};
+
+struct Counted {
+    int value = 0;
+    Counted() { live_counted.fetch_add(1); }
+    Counted(Counted const& other) : value{other.value} { live_counted.fetch_add(1); }
+    Counted& operator=(Counted const&) = default;
+    ~Counted() { live_counted.fetch_sub(1); }
+};
+
+TEST(PinTest, OnlyThePinnedVersionIsHeldBack) {
+    {
+        wbrcu::rcu_protected<Counted> p{new Counted{}};
+        p.update([](Counted* c) { c->value = 1; });
+
+        auto pinned = p.pin();
+        for (int i = 2; i <= 1000; ++i) {
+            p.update([i](Counted* c) { c->value = i; });
+        }
+        // The other versions were reclaimed and their storage reused.
+        EXPECT_LT(live_counted.load(), 100);
+        EXPECT_EQ(pinned->value, 1);
+    }
+    EXPECT_EQ(live_counted.load(), 0);
+}
+
+TEST(AdoptTest, AdoptedVersionIsReleasedNotPooled) {
+    static std::array<int, 16> const initial = [] {
+        std::array<int, 16> a{};
+        a.fill(3);
+        return a;
+    }();
+    int released = 0;
+    auto release = [&](std::array<int, 16> const*) { ++released; };
+    std::unique_ptr<std::array<int, 16> const, decltype(release)> adopted(
+        &initial, release);
+
+    {
+        wbrcu::rcu_protected<std::array<int, 16>> p{std::move(adopted)};
+        EXPECT_EQ((*p.get_ptr())[0], 3);
+        for (int i = 4; i < 200; ++i) {
+            p.update([i](auto* a) { a->fill(i); });
+        }
+        EXPECT_EQ(released, 1);
+        EXPECT_EQ((*p.get_ptr())[0], 199);
+    }
+    EXPECT_EQ(released, 1);
+    EXPECT_EQ(initial[0], 3);
+}
+
+TEST(AdoptTest, ReleasedWithObjectIfNeverUpdated) {
+    int released = 0;
+    auto release = [&](int const* v) { ++released; delete v; };
+    {
+        wbrcu::rcu_protected<int> p{
+            std::unique_ptr<int const, decltype(release)>(new int(1), release)};
+        EXPECT_EQ(*p.get_ptr(), 1);
+    }
+    EXPECT_EQ(released, 1);
+}
+
+TEST(ReadGuardTest, NestedReadsKeepOuterProtected) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    auto outer = p.get_ptr();
+    {
+        auto inner = p.get_ptr();
+        auto guard = p.get_guard();
+        EXPECT_EQ(*inner, 0);
+        EXPECT_EQ(*guard, 0);
+    }
+
+    // Leaving the inner sections must not end the outer one, so the object
+    // it loaded is neither freed nor reused by these updates.
+    std::thread writer([&p]() {
+        for (int i = 1; i <= 100; ++i) {
+            p.update([i](int* v) { *v = i; });
+        }
+    });
+    writer.join();
+    EXPECT_EQ(*outer, 0);
+    EXPECT_EQ(*p.get_guard(), 100);
+}
+
+TEST(ReadGuardTest, NestingTooDeepAborts) {
+    wbrcu::rcu_domain<> domain;
+    for (uint8_t i = 0; i < wbrcu::detail::max_read_depth; ++i) {
+        domain.lock();
+    }
+    EXPECT_DEATH(domain.lock(), "nested too deep");
+    for (uint8_t i = 0; i < wbrcu::detail::max_read_depth; ++i) {
+        domain.unlock();
+    }
+}
+
+TEST(ReadGuardTest, MoveAndRelease) {
+    wbrcu::rcu_protected<int> p{new int(1)};
+    auto load = [&p]() { return p.get_guard(); };
+
+    wbrcu::read_guard<int> guard = load();
+    ASSERT_TRUE(guard);
+    EXPECT_EQ(*guard, 1);
+
+    wbrcu::read_guard<int> moved = std::move(guard);
+    EXPECT_FALSE(guard);
+    EXPECT_EQ(*moved.get(), 1);
+
+    moved.release();
+    EXPECT_FALSE(moved);
+    EXPECT_EQ(moved.get(), nullptr);
+
+    // With every section left, updates can reclaim old versions freely.
+    for (int i = 2; i <= 10; ++i) {
+        p.update([i](int* v) { *v = i; });
+    }
+    EXPECT_EQ(*p.get_guard(), 10);
+}
+
+// Coroutine that starts eagerly and destroys itself when it finishes.
+struct detached {
+    struct promise_type {
+        detached get_return_object() { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+TEST(CoroutineTest, UpdateAsyncResumesAfterPublish) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::atomic<int> seen(-1);
+    auto writer = [](wbrcu::rcu_protected<int>& p, std::atomic<int>& seen) -> detached {
+        co_await p.update_async([](int* v) { *v = 7; });
+        seen = *p.get_ptr();
+    };
+    writer(p, seen);
+    EXPECT_EQ(seen.load(), 7);
+    EXPECT_EQ(p.version(), 1u);
+}
+
+TEST(CoroutineTest, UpdateAsyncDoesNotBlockOnFullQueue) {
+    constexpr int num_updates = 500 * wbrcu::hardware_concurrency + 100;
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::atomic<bool> registered(false);
+    std::atomic<bool> release(false);
+    std::atomic<int> resumed(0);
+
+    // Hold the updater role so that every update_async below is queued, more
+    // of them than the queue holds.
+    std::thread updater([&]() {
+        p.update([&](int*) {
+            registered = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+    });
+    while (!registered) {
+        std::this_thread::yield();
+    }
+
+    // Only the updater appends to order.
+    std::vector<int> order;
+    auto writer = [](wbrcu::rcu_protected<int>& p, std::atomic<int>& resumed,
+                     std::vector<int>& order, int i) -> detached {
+        co_await p.update_async([&order, i](int* v) {
+            ++*v;
+            order.push_back(i);
+        });
+        resumed.fetch_add(1);
+    };
+    for (int i = 0; i < num_updates; ++i) {
+        writer(p, resumed, order, i);
+    }
+    EXPECT_EQ(resumed.load(), 0);
+
+    release = true;
+    updater.join();
+    EXPECT_EQ(resumed.load(), num_updates);
+    EXPECT_EQ(*p.get_ptr(), num_updates);
+    // Overflowed updates run after the queued ones, in the order they came.
+    ASSERT_EQ(order.size(), static_cast<size_t>(num_updates));
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(CoroutineTest, OverflowedUpdateKeepsProgramOrder) {
+    constexpr int queue_capacity = 500 * wbrcu::hardware_concurrency;
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::atomic<bool> registered(false);
+    std::atomic<bool> release(false);
+    std::atomic<bool> enqueued(false);
+
+    std::thread updater([&]() {
+        p.update([&](int*) {
+            registered = true;
+            while (!release) {
+                std::this_thread::yield();
+            }
+        });
+    });
+    while (!registered) {
+        std::this_thread::yield();
+    }
+
+    // Only the updater appends to order. The first queued update holds the
+    // updater until the last one has found room in the queue, so that the
+    // overflowed update is still pending behind a non-empty queue.
+    std::vector<int> order;
+    auto writer = [](wbrcu::rcu_protected<int>& p, std::vector<int>& order,
+                     std::atomic<bool>& enqueued, int i) -> detached {
+        co_await p.update_async([&order, &enqueued, i](int*) {
+            while (i == 0 && !enqueued) {
+                std::this_thread::yield();
+            }
+            order.push_back(i);
+        });
+    };
+    std::thread enqueuer([&]() {
+        // Fill the queue and overflow one update, then enqueue a later one
+        // from the same thread.
+        for (int i = 0; i <= queue_capacity; ++i) {
+            writer(p, order, enqueued, i);
+        }
+        release = true;
+        p.update([&order, last = queue_capacity + 1](int*) { order.push_back(last); });
+        enqueued = true;
+    });
+
+    updater.join();
+    enqueuer.join();
+    ASSERT_EQ(order.size(), static_cast<size_t>(queue_capacity + 2));
+    EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+}
+
+TEST(CoroutineTest, ChangedSinceResumesOnPublish) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    uint64_t resumed_at = 0;
+    auto watcher = [](wbrcu::rcu_protected<int>& p, uint64_t& resumed_at) -> detached {
+        resumed_at = co_await p.changed_since(p.version());
+    };
+    watcher(p, resumed_at);
+    EXPECT_EQ(resumed_at, 0u);
+
+    p.update([](int* v) { *v = 1; });
+    EXPECT_EQ(resumed_at, 1u);
+
+    // Already past the version, the coroutine does not suspend.
+    auto late = [](wbrcu::rcu_protected<int>& p, uint64_t& resumed_at) -> detached {
+        resumed_at = co_await p.changed_since(0);
+    };
+    resumed_at = 0;
+    late(p, resumed_at);
+    EXPECT_EQ(resumed_at, 1u);
+}
+
+TEST(CoroutineTest, SynchronizeWaitsForReaders) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::atomic<bool> done(false);
+    auto waiter = [](wbrcu::rcu_protected<int>& p, std::atomic<bool>& done) -> detached {
+        co_await p.synchronize();
+        done = true;
+    };
+
+    std::atomic<bool> locked(false);
+    std::atomic<bool> unlock(false);
+    std::thread reader([&]() {
+        auto ptr = p.get_ptr();
+        locked = true;
+        while (!unlock) {
+            std::this_thread::yield();
+        }
+    });
+    while (!locked) {
+        std::this_thread::yield();
+    }
+
+    waiter(p, done);
+    for (int i = 0; i < 10; ++i) {
+        p.domain().poll();
+    }
+    EXPECT_FALSE(done.load());
+
+    unlock = true;
+    reader.join();
+    for (int i = 0; i < 10 && !done; ++i) {
+        p.domain().poll();
+    }
+    EXPECT_TRUE(done.load());
+}
+
+TEST(CoroutineTest, SynchronizeOnIdleObjectNeedsNoDriver) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    bool done = false;
+    auto waiter = [](wbrcu::rcu_protected<int>& p, bool& done) -> detached {
+        co_await p.synchronize();
+        done = true;
+    };
+    // Nothing polls the domain and there are no updates.
+    waiter(p, done);
+    EXPECT_TRUE(done);
+}
+
+TEST(WaitForChangeTest, WakesOnPublish) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    std::atomic<uint64_t> woken_at(0);
+    std::thread watcher([&]() {
+        woken_at = p.wait_for_change(0);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    EXPECT_EQ(woken_at.load(), 0u);
+    p.update([](int* v) { *v = 1; });
+    watcher.join();
+    EXPECT_EQ(woken_at.load(), 1u);
+    EXPECT_EQ(p.wait_for_change(0), 1u);
+}
+
+TEST(WaitForChangeTest, TimesOut) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(p.wait_for_change(0, std::chrono::milliseconds(20)), 0u);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+}
+
 int main(int argc, char **argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
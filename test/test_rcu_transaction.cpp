@@ -0,0 +1,197 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "wbrcu/rcu_transaction.hpp"
+
+TEST(TransactionTest, UpdatesAreSeenTogether) {
+    constexpr int num_reader_threads = 4;
+    constexpr int num_operations = 2000;
+
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> forward{new int(0), domain};
+    wbrcu::rcu_protected<long> reverse{new long(0), domain};
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> done(false);
+    std::atomic<int> torn_reads(0);
+
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads.emplace_back([&]() {
+            while (!done) {
+                auto [f, r] = wbrcu::multi_read_guard{forward, reverse};
+                if (*f != -*r) {
+                    torn_reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    // Two transactions over the same instances, in opposite argument order.
+    threads.emplace_back([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            wbrcu::update_together([](int* f, long* r) { ++*f; --*r; }, forward, reverse);
+        }
+    });
+    threads.emplace_back([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            wbrcu::update_together([](long* r, int* f) { ++*f; --*r; }, reverse, forward);
+        }
+    });
+
+    for (size_t i = num_reader_threads; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    done = true;
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads[i].join();
+    }
+
+    EXPECT_EQ(torn_reads.load(), 0);
+    wbrcu::multi_read_guard guard{forward, reverse};
+    EXPECT_EQ(*guard.get<0>(), 2 * num_operations);
+    EXPECT_EQ(*guard.get<1>(), -2 * num_operations);
+}
+
+TEST(TransactionTest, MixesWithPlainUpdates) {
+    constexpr int num_operations = 1000;
+
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<int> second{new int(0), domain};
+
+    std::thread plain([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            first.update([](int* v) { ++*v; });
+        }
+    });
+    std::thread transactional([&]() {
+        for (int i = 0; i < num_operations; ++i) {
+            wbrcu::update_together([](int* a, int* b) { ++*a; ++*b; }, first, second);
+        }
+    });
+    plain.join();
+    transactional.join();
+
+    EXPECT_EQ(*first.get_ptr(), 2 * num_operations);
+    EXPECT_EQ(*second.get_ptr(), num_operations);
+}
+
+TEST(TransactionTest, NotStarvedByUpdates) {
+    constexpr int num_updater_threads = 2;
+    constexpr int num_transactions = 100;
+
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<int> second{new int(0), domain};
+
+    // Keep the updater role busy until every transaction has gone through.
+    std::atomic<bool> finished(false);
+    std::atomic<int> updates(0);
+    std::vector<std::thread> updaters;
+    for (int i = 0; i < num_updater_threads; ++i) {
+        updaters.emplace_back([&]() {
+            while (!finished) {
+                first.update([](int* v) { ++*v; });
+                updates.fetch_add(1, std::memory_order_relaxed);
+            }
+        });
+    }
+    for (int i = 0; i < num_transactions; ++i) {
+        wbrcu::update_together([](int* a, int* b) { ++*a; ++*b; }, first, second);
+    }
+    finished = true;
+    for (auto& t : updaters) {
+        t.join();
+    }
+
+    EXPECT_EQ(*first.get_ptr(), updates.load() + num_transactions);
+    EXPECT_EQ(*second.get_ptr(), num_transactions);
+}
+
+namespace {
+
+// Command set whose only command has no default constructor.
+struct Counter {
+    struct Add {
+        explicit Add(int n) : n{n} {}
+        int n;
+    };
+    using command = std::variant<Add>;
+
+    int value = 0;
+    void apply(Add const& add) { value += add.n; }
+};
+
+} // namespace
+
+TEST(TransactionTest, NotStarvedByCommandUpdates) {
+    constexpr int num_transactions = 100;
+
+    wbrcu::rcu_domain<> domain;
+    wbrcu::command_protected<Counter> first{new Counter{}, domain};
+    wbrcu::command_protected<Counter> second{new Counter{}, domain};
+
+    // The updater role is handed over even though no marker command can be
+    // default-constructed.
+    std::atomic<bool> finished(false);
+    std::atomic<int> updates(0);
+    std::thread updater([&]() {
+        while (!finished) {
+            first.update(Counter::Add{1});
+            updates.fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    for (int i = 0; i < num_transactions; ++i) {
+        wbrcu::update_together([](Counter* a, Counter* b) { ++a->value; ++b->value; }, first, second);
+    }
+    finished = true;
+    updater.join();
+
+    EXPECT_EQ(first.get_ptr()->value, updates.load() + num_transactions);
+    EXPECT_EQ(second.get_ptr()->value, num_transactions);
+}
+
+TEST(TransactionTest, ReleasesInstancesWhenCallbackThrows) {
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<int> second{new int(0), domain};
+
+    EXPECT_THROW(
+        wbrcu::update_together(
+            [](int* a, int* b) {
+                ++*a;
+                ++*b;
+                throw std::runtime_error("failed");
+            },
+            first, second),
+        std::runtime_error);
+    EXPECT_EQ(*first.get_ptr(), 0);
+    EXPECT_EQ(*second.get_ptr(), 0);
+
+    // Neither instance is left with an updater that never returns.
+    first.update([](int* v) { *v += 2; });
+    wbrcu::update_together([](int* a, int* b) { ++*a; ++*b; }, first, second);
+    EXPECT_EQ(*first.get_ptr(), 3);
+    EXPECT_EQ(*second.get_ptr(), 1);
+}
+
+TEST(TransactionTest, HooksRunAfterThePublishSequence) {
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<int> second{new int(0), domain};
+
+    // A hook reading the domain as a whole would spin forever if it ran
+    // while the transaction held the publish sequence odd.
+    std::vector<std::pair<int, int>> seen;
+    first.on_publish([&](auto const&) {
+        auto [a, b] = wbrcu::multi_read_guard{first, second};
+        seen.emplace_back(*a, *b);
+    });
+
+    wbrcu::update_together([](int* a, int* b) { ++*a; ++*b; }, first, second);
+    EXPECT_EQ(seen, (std::vector<std::pair<int, int>>{{1, 1}}));
+}
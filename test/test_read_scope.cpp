@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include "wbrcu/read_scope.hpp"
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/rcu_transaction.hpp"
+
+TEST(ReadScopeTest, ReadsManyObjects) {
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> number{new int(1), domain};
+    wbrcu::rcu_protected<std::string> name{new std::string("one"), domain};
+
+    {
+        wbrcu::read_scope scope{domain};
+        int const* n = scope.get(number);
+        std::string const* s = scope.get(name);
+
+        std::thread writer([&]() {
+            number.update([](int* v) { *v = 2; });
+            name.update([](std::string* v) { *v = "two"; });
+        });
+        writer.join();
+
+        // Objects loaded in the scope are still readable.
+        EXPECT_EQ(*n, 1);
+        EXPECT_EQ(*s, "one");
+        EXPECT_EQ(*scope.get(number), 2);
+        EXPECT_EQ(*scope.get(name), "two");
+    }
+}
+
+TEST(ReadScopeTest, ConsistentGet) {
+    constexpr int num_reader_threads = 4;
+    constexpr int num_operations = 2000;
+
+    wbrcu::rcu_domain<> domain;
+    wbrcu::rcu_protected<int> first{new int(0), domain};
+    wbrcu::rcu_protected<int> second{new int(0), domain};
+
+    std::vector<std::thread> threads;
+    std::atomic<bool> done(false);
+    std::atomic<int> torn_reads(0);
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads.emplace_back([&]() {
+            while (!done) {
+                wbrcu::read_scope scope{domain};
+                auto [a, b] = scope.get(first, second);
+                if (*a != *b) {
+                    torn_reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < num_operations; ++i) {
+        wbrcu::update_together([](int* a, int* b) { ++*a; ++*b; }, first, second);
+    }
+    done = true;
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(torn_reads.load(), 0);
+}
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "wbrcu/seqlock_protected.hpp"
+
+class SeqlockTest : public ::testing::Test {
+protected:
+    struct Pair {
+        uint64_t first;
+        uint64_t second;
+    };
+
+    wbrcu::seqlock_protected<Pair> seq_obj{new Pair{0, 0}};
+};
+
+static_assert(wbrcu::seqlock_eligible<uint64_t>);
+static_assert(!wbrcu::seqlock_eligible<std::vector<int>>);
+static_assert(std::is_same_v<wbrcu::auto_protected<uint64_t>, wbrcu::seqlock_protected<uint64_t>>);
+static_assert(std::is_same_v<wbrcu::auto_protected<std::vector<int>>, wbrcu::rcu_protected<std::vector<int>>>);
+
+TEST_F(SeqlockTest, InitialValueIsZero) {
+    auto ptr = seq_obj.get_ptr();
+    EXPECT_EQ(ptr->first, 0u);
+    EXPECT_EQ(ptr->second, 0u);
+}
+
+TEST_F(SeqlockTest, BasicUpdate) {
+    seq_obj.update([](Pair* p) { p->first = 42; });
+    EXPECT_EQ(seq_obj.load().first, 42u);
+}
+
+TEST_F(SeqlockTest, ConcurrentReadsSeeConsistentValues) {
+    constexpr int num_reader_threads = 4;
+    constexpr int num_updater_threads = 3;
+    constexpr int num_operations = 1000;
+
+    std::vector<std::thread> threads;
+    std::atomic<int> torn_reads(0);
+
+    for (int i = 0; i < num_reader_threads; ++i) {
+        threads.emplace_back([this, &torn_reads]() {
+            for (int j = 0; j < num_operations; ++j) {
+                auto ptr = seq_obj.get_ptr();
+                if (ptr->first != ptr->second) {
+                    torn_reads.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+        });
+    }
+
+    for (int i = 0; i < num_updater_threads; ++i) {
+        threads.emplace_back([this]() {
+            for (int j = 0; j < num_operations; ++j) {
+                seq_obj.update([](Pair* p) {
+                    p->first++;
+                    p->second++;
+                });
+            }
+        });
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(torn_reads.load(), 0);
+    auto final_ptr = seq_obj.get_ptr();
+    EXPECT_EQ(final_ptr->first, uint64_t{num_updater_threads * num_operations});
+}
+
+TEST_F(SeqlockTest, NestedUpdates) {
+    seq_obj.update([this](Pair* p) {
+        p->first = 1;
+        seq_obj.update([](Pair* inner) { inner->first *= 2; });
+    });
+
+    EXPECT_EQ(seq_obj.load().first, 2u);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "wbrcu/sharded_map.hpp"
+
+TEST(ShardedMapTest, InsertFindErase) {
+    wbrcu::sharded_map<int, int, 4> map;
+    for (int i = 0; i < 100; ++i) {
+        map.insert_or_assign(i, i * 2);
+    }
+    EXPECT_EQ(map.size(), 100u);
+    EXPECT_EQ(map.find(21), 42);
+    EXPECT_FALSE(map.find(100).has_value());
+
+    map.erase(21);
+    EXPECT_FALSE(map.contains(21));
+    EXPECT_EQ(map.size(), 99u);
+}
+
+TEST(ShardedMapTest, UpdateTouchesOwningShard) {
+    wbrcu::sharded_map<int, int, 8> map;
+    map.insert_or_assign(5, 1);
+    map.update(5, [](auto* shard) { shard->insert_or_assign(5, *shard->find(5) + 1); });
+    EXPECT_EQ(map.find(5), 2);
+}
+
+TEST(ShardedMapTest, ForEachVisitsAllShards) {
+    wbrcu::sharded_map<int, int, 8> map;
+    for (int i = 0; i < 64; ++i) {
+        map.insert_or_assign(i, 1);
+    }
+
+    int sum = 0;
+    map.for_each([&](int, int value) { sum += value; });
+    EXPECT_EQ(sum, 64);
+}
+
+TEST(ShardedMapTest, ConcurrentWritersToDifferentKeys) {
+    constexpr int num_threads = 8;
+    constexpr int num_operations = 1000;
+
+    wbrcu::sharded_map<int, int, 4> map;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&map, i]() {
+            for (int j = 0; j < num_operations; ++j) {
+                map.insert_or_assign(i * num_operations + j, j);
+                (void)map.find(j);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    EXPECT_EQ(map.size(), size_t{num_threads * num_operations});
+    EXPECT_EQ(map.find(3 * num_operations + 7), 7);
+}
@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "wbrcu/shm_rcu_protected.hpp"
+
+namespace {
+
+struct Table {
+    std::array<uint64_t, 64> values{};
+};
+
+std::string segment_name(char const* test) {
+    return "/wbrcu_" + std::string(test) + "_" + std::to_string(getpid());
+}
+
+} // namespace
+
+TEST(ShmRcuProtectedTest, ReaderSeesPublishedVersions) {
+    auto name = segment_name("publish");
+    wbrcu::shm_rcu_protected<Table> writer{name, Table{}};
+    wbrcu::shm_rcu_reader<Table> reader{name};
+
+    EXPECT_EQ(reader.get_ptr()->values[0], 0u);
+    for (uint64_t i = 1; i <= 100; ++i) {
+        writer.update([i](Table* t) { t->values.fill(i); });
+        auto ptr = reader.get_ptr();
+        EXPECT_EQ(ptr->values[0], i);
+        EXPECT_EQ(ptr->values[63], i);
+    }
+    EXPECT_EQ(reader.version(), 100u);
+    EXPECT_EQ(writer.get_ptr()->values[0], 100u);
+}
+
+TEST(ShmRcuProtectedTest, ReaderKeepsVersionWhileUpdated) {
+    auto name = segment_name("keep");
+    wbrcu::shm_rcu_protected<Table> writer{name, Table{}, 3};
+    wbrcu::shm_rcu_reader<Table> reader{name};
+
+    writer.update([](Table* t) { t->values.fill(7); });
+    {
+        auto held = reader.get_ptr();
+        // With three blocks the updater can publish one more version
+        // without reusing the held one.
+        writer.update([](Table* t) { t->values.fill(8); });
+        EXPECT_EQ(held->values[0], 7u);
+        EXPECT_EQ(reader.get_ptr()->values[0], 8u);
+    }
+    for (uint64_t i = 9; i < 20; ++i) {
+        writer.update([i](Table* t) { t->values.fill(i); });
+    }
+    EXPECT_EQ(reader.get_ptr()->values[0], 19u);
+}
+
+TEST(ShmRcuProtectedTest, ReaderProcess) {
+    auto name = segment_name("process");
+    wbrcu::shm_rcu_protected<Table> writer{name, Table{}};
+    writer.update([](Table* t) { t->values.fill(1); });
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        wbrcu::shm_rcu_reader<Table> reader{name};
+        uint64_t last = 0;
+        // Versions only move forward and are never torn.
+        while (last < 1000) {
+            auto ptr = reader.get_ptr();
+            uint64_t value = ptr->values[0];
+            if (value < last || ptr->values[63] != value) { _exit(1); }
+            last = value;
+        }
+        _exit(0);
+    }
+    for (uint64_t i = 2; i <= 1000; ++i) {
+        writer.update([i](Table* t) { t->values.fill(i); });
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    ASSERT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+}
+
+TEST(ShmRcuProtectedTest, DeadReaderIsReaped) {
+    auto name = segment_name("dead");
+    wbrcu::shm_rcu_protected<Table> writer{name, Table{}, 3, 2};
+
+    int ready[2];
+    ASSERT_EQ(pipe(ready), 0);
+    pid_t pid = fork();
+    if (pid == 0) {
+        wbrcu::shm_rcu_reader<Table> reader{name};
+        auto ptr = reader.get_ptr();
+        char c = 1;
+        (void)!write(ready[1], &c, 1);
+        // Die inside the critical section.
+        pause();
+        _exit(0);
+    }
+    char c;
+    ASSERT_EQ(read(ready[0], &c, 1), 1);
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    close(ready[0]);
+    close(ready[1]);
+
+    // Would wait forever for the dead reader without reaping its slot.
+    for (uint64_t i = 1; i <= 10; ++i) {
+        writer.update([i](Table* t) { t->values.fill(i); });
+    }
+    EXPECT_EQ(writer.get_ptr()->values[0], 10u);
+
+    // The reaped slot can be taken by a new reader.
+    wbrcu::shm_rcu_reader<Table> reader{name};
+    EXPECT_EQ(reader.get_ptr()->values[0], 10u);
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/snapshot.hpp"
+
+namespace {
+
+std::filesystem::path snapshot_path(char const* test) {
+    return std::filesystem::temp_directory_path()
+        / ("wbrcu_" + std::string(test) + "_" + std::to_string(getpid()));
+}
+
+std::string read_file(std::filesystem::path const& path) {
+    std::ifstream in(path, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+} // namespace
+
+TEST(SnapshotTest, ExportsRawObject) {
+    auto path = snapshot_path("raw");
+    wbrcu::rcu_protected<std::array<int, 16>> p{new std::array<int, 16>{}};
+    p.update([](auto* a) { a->fill(7); });
+
+    wbrcu::export_snapshot(p, path).get();
+    // Later updates do not change the exported file.
+    p.update([](auto* a) { a->fill(8); });
+
+    std::string file = read_file(path);
+    ASSERT_EQ(file.size(), wbrcu::snapshot_header::payloadOffset + sizeof(std::array<int, 16>));
+    wbrcu::snapshot_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    EXPECT_EQ(header.magic, wbrcu::snapshot_header::magicValue);
+    EXPECT_EQ(header.payloadSize, sizeof(std::array<int, 16>));
+
+    std::array<int, 16> exported;
+    std::memcpy(&exported, file.data() + header.offset, sizeof(exported));
+    for (int value : exported) {
+        EXPECT_EQ(value, 7);
+    }
+    EXPECT_FALSE(std::filesystem::exists(path.string() + ".tmp"));
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, CustomSerializerRunsWhileUpdating) {
+    auto path = snapshot_path("custom");
+    wbrcu::rcu_protected<std::vector<int>> p{new std::vector<int>{1, 2, 3}};
+
+    std::atomic<bool> release(false);
+    auto exported = wbrcu::export_snapshot(
+        p, path, [&](std::vector<int> const& v, wbrcu::snapshot_sink& sink) {
+            // Hold the version while the object is updated.
+            while (!release) {
+                std::this_thread::yield();
+            }
+            sink.write(v.data(), v.size() * sizeof(int));
+        });
+
+    for (int i = 0; i < 100; ++i) {
+        p.update([i](std::vector<int>* v) { v->assign(3, i); });
+    }
+    release = true;
+    exported.get();
+
+    std::string file = read_file(path);
+    ASSERT_EQ(file.size(), wbrcu::snapshot_header::payloadOffset + 3 * sizeof(int));
+    int values[3];
+    std::memcpy(values, file.data() + wbrcu::snapshot_header::payloadOffset, sizeof(values));
+    EXPECT_EQ(values[0], 1);
+    EXPECT_EQ(values[2], 3);
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, FailedExportReportsError) {
+    wbrcu::rcu_protected<int> p{new int(0)};
+    auto exported = wbrcu::export_snapshot(p, "/nonexistent/dir/snapshot");
+    EXPECT_THROW(exported.get(), std::system_error);
+}
+
+TEST(SnapshotTest, WarmStartFromMappedSnapshot) {
+    auto path = snapshot_path("warm");
+    {
+        wbrcu::rcu_protected<std::array<int, 16>> p{new std::array<int, 16>{}};
+        p.update([](auto* a) { a->fill(5); });
+        wbrcu::export_snapshot(p, path).get();
+    }
+
+    wbrcu::rcu_protected<std::array<int, 16>> p{
+        wbrcu::map_snapshot<std::array<int, 16>>(path)};
+    EXPECT_EQ((*p.get_ptr())[15], 5);
+
+    // Updates copy the mapped version instead of writing to it.
+    for (int i = 6; i < 100; ++i) {
+        p.update([](auto* a) { (*a)[0] += 1; });
+    }
+    EXPECT_EQ((*p.get_ptr())[0], 5 + 94);
+    EXPECT_EQ((*p.get_ptr())[15], 5);
+    std::filesystem::remove(path);
+}
+
+TEST(SnapshotTest, MapRejectsOtherType) {
+    auto path = snapshot_path("reject");
+    wbrcu::rcu_protected<int> p{new int(1)};
+    wbrcu::export_snapshot(p, path).get();
+    using Table = std::array<int, 16>;
+    EXPECT_THROW(wbrcu::map_snapshot<Table>(path), std::runtime_error);
+    EXPECT_EQ(*wbrcu::map_snapshot<int>(path), 1);
+    std::filesystem::remove(path);
+}
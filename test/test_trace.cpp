@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/trace.hpp"
+
+TEST(TraceTest, RecordsReadsAndUpdates) {
+    wbrcu::trace_recorder recorder;
+    wbrcu::rcu_protected<int> p{new int(0)};
+    p.trace_to(recorder);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 10; ++i) {
+                auto ptr = p.get_ptr();
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+            p.update([](int* v) { ++*v; });
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+
+    auto events = recorder.events();
+    ASSERT_EQ(events.size(), 33u);
+    std::set<uint16_t> thread_ids;
+    int reads = 0;
+    for (size_t i = 0; i < events.size(); ++i) {
+        if (i > 0) {
+            EXPECT_LE(events[i - 1].start_ns, events[i].start_ns);
+        }
+        thread_ids.insert(events[i].thread);
+        if (events[i].kind == wbrcu::trace_kind::read) {
+            ++reads;
+            EXPECT_GE(events[i].duration_ns, 100'000u);
+        }
+    }
+    EXPECT_EQ(reads, 30);
+    EXPECT_EQ(thread_ids, (std::set<uint16_t>{0, 1, 2}));
+}
+
+TEST(TraceTest, WriteAndReadBack) {
+    auto path = std::filesystem::temp_directory_path()
+        / ("wbrcu_trace_" + std::to_string(getpid()));
+    wbrcu::trace_recorder recorder;
+    wbrcu::rcu_protected<int> p{new int(0)};
+    p.trace_to(recorder);
+    for (int i = 0; i < 5; ++i) {
+        p.update([](int* v) { ++*v; });
+        auto ptr = p.get_ptr();
+    }
+    recorder.write(path);
+
+    auto events = wbrcu::read_trace(path);
+    auto expected = recorder.events();
+    ASSERT_EQ(events.size(), 10u);
+    for (size_t i = 0; i < events.size(); ++i) {
+        EXPECT_EQ(events[i].start_ns, expected[i].start_ns);
+        EXPECT_EQ(events[i].kind, expected[i].kind);
+    }
+    std::filesystem::remove(path);
+}
+
+TEST(TraceTest, ThreadKeepsItsBufferAcrossRecorders) {
+    // More recorders than a thread caches, recorded to in turn.
+    constexpr int num_recorders = 6;
+    constexpr int num_rounds = 5;
+    std::vector<std::unique_ptr<wbrcu::trace_recorder>> recorders;
+    std::vector<std::unique_ptr<wbrcu::rcu_protected<int>>> objects;
+    for (int i = 0; i < num_recorders; ++i) {
+        recorders.push_back(std::make_unique<wbrcu::trace_recorder>());
+        objects.push_back(std::make_unique<wbrcu::rcu_protected<int>>(new int(0)));
+        objects.back()->trace_to(*recorders.back());
+    }
+    for (int round = 0; round < num_rounds; ++round) {
+        for (auto& p : objects) {
+            p->get_ptr();
+        }
+    }
+
+    for (auto& recorder : recorders) {
+        auto events = recorder->events();
+        ASSERT_EQ(events.size(), static_cast<size_t>(num_rounds));
+        for (auto const& event : events) {
+            EXPECT_EQ(event.thread, 0u);
+        }
+    }
+    EXPECT_EQ(recorders[0]->dropped(), 0u);
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "wbrcu/rcu_protected.hpp"
+#include "wbrcu/seqlock_protected.hpp"
+#include "wbrcu/write_combiner.hpp"
+
+namespace {
+
+using Counters = std::array<uint64_t, 8>;
+
+std::atomic<int> merges{0};
+
+struct AddCounters {
+    void operator()(Counters* counters, Counters&& delta) const {
+        merges.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < counters->size(); ++i) {
+            (*counters)[i] += delta[i];
+        }
+    }
+};
+
+} // namespace
+
+TEST(WriteCombinerTest, AllIncrementsAreMerged) {
+    constexpr int num_threads = 4;
+    constexpr int num_operations = 10000;
+
+    merges = 0;
+    wbrcu::rcu_protected<Counters> p{new Counters{}};
+    {
+        wbrcu::write_combiner<decltype(p), Counters, AddCounters> combiner{p};
+        std::vector<std::thread> threads;
+        for (int i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&, i]() {
+                for (int j = 0; j < num_operations; ++j) {
+                    combiner.combine([i](Counters& delta) { ++delta[i]; });
+                }
+            });
+        }
+        for (auto& t : threads) {
+            t.join();
+        }
+    }
+
+    auto ptr = p.get_ptr();
+    for (int i = 0; i < num_threads; ++i) {
+        EXPECT_EQ((*ptr)[i], uint64_t{num_operations});
+    }
+    EXPECT_LE(merges.load(), num_threads * num_operations);
+    EXPECT_GE(merges.load(), num_threads);
+}
+
+TEST(WriteCombinerTest, WorksWithSeqlockProtected) {
+    wbrcu::seqlock_protected<uint64_t> p{new uint64_t{0}};
+    auto add = [](uint64_t* value, uint64_t&& delta) { *value += delta; };
+    wbrcu::write_combiner<decltype(p), uint64_t, decltype(add)> combiner{p, add};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 1000; ++j) {
+                combiner.combine([](uint64_t& delta) { ++delta; });
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    EXPECT_EQ(p.load(), 4000u);
+}